@@ -0,0 +1,53 @@
+/**
+ * \file allocation-count.cpp
+ *
+ * \brief Replaces the global operator new and operator delete with
+ *        versions that count allocations.
+ */
+
+#include <cstdlib>
+#include <new>
+
+#include "allocation-count.hpp"
+
+std::atomic<size_t> allocations(0);
+
+// The replacements are kept out of line, where the compiler can't mistake
+// the free of a block from operator new for a mismatched deallocation
+
+[[gnu::noinline]] void* operator new(size_t size)
+{
+    ++allocations;
+    if (void* block = std::malloc(size == 0 ? 1 : size)) {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* block) noexcept
+{
+    std::free(block);
+}
+
+[[gnu::noinline]] void operator delete(void* block, size_t) noexcept
+{
+    std::free(block);
+}
+
+// Arrays too, since a library (or a sanitizer) need not route new[]
+// through operator new
+
+[[gnu::noinline]] void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+[[gnu::noinline]] void operator delete[](void* block) noexcept
+{
+    std::free(block);
+}
+
+[[gnu::noinline]] void operator delete[](void* block, size_t) noexcept
+{
+    std::free(block);
+}
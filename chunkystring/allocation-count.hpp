@@ -0,0 +1,21 @@
+/**
+ * \file allocation-count.hpp
+ *
+ * \brief Counts calls to operator new, for the benchmarks' allocs/op
+ *        figures and the small-string tests.
+ *
+ * \details Linking allocation-count.o replaces the global operator new
+ *   and operator delete, and their array forms, with versions that count
+ *   as they go; read the count before and after the work being measured.
+ */
+
+#ifndef ALLOCATION_COUNT_HPP_INCLUDED
+#define ALLOCATION_COUNT_HPP_INCLUDED 1
+
+#include <atomic>
+#include <cstddef>
+
+/// Calls to operator new and new[] so far, from every thread
+extern std::atomic<size_t> allocations;
+
+#endif // ALLOCATION_COUNT_HPP_INCLUDED
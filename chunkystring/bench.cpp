@@ -0,0 +1,380 @@
+/**
+ * \file bench.cpp
+ *
+ * \brief Microbenchmarks for ChunkyString, against std::string,
+ *        std::deque<char> and std::list<char>.
+ *
+ * \details
+ *    Each benchmark runs for every string type, which covers a few
+ *    values of CHUNKSIZE, and over a range of string sizes.  Besides the
+ *    time per iteration, each one reports
+ *      - time/op: time per character pushed, inserted, erased, compared,
+ *        visited or printed,
+ *      - bytes_per_second: characters handled per second,
+ *      - allocs/op: calls to operator new per operation, and
+ *      - utilization: for ChunkyStrings, the utilization() left behind.
+ *
+ *    Build with "make bench" (needs Google Benchmark) and run ./bench;
+ *    --benchmark_filter picks out benchmarks, e.g. 'Insert.*Chunky'.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <iterator>
+#include <list>
+#include <ostream>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "chunkystring.hpp"
+#include "noisy-transmission.hpp"
+#include "allocation-count.hpp"
+
+using namespace std;
+
+//--------------------------------------------------
+//           ALLOCATION COUNTING
+//--------------------------------------------------
+
+/**
+ * \brief Counts the allocations made while a benchmark's clock runs.
+ *
+ * \details Call pause() and resume() around untimed setup, in place of
+ *   state.PauseTiming() and state.ResumeTiming(), so that allocations
+ *   made by the setup aren't counted either.
+ */
+class AllocationCounter {
+public:
+    explicit AllocationCounter(benchmark::State& state)
+        : state_(state), counted_(0), start_(allocations)
+    {
+        // Counting from now on
+    }
+
+    void pause()
+    {
+        state_.PauseTiming();
+        counted_ += allocations - start_;
+    }
+
+    void resume()
+    {
+        start_ = allocations;
+        state_.ResumeTiming();
+    }
+
+    /// Report the per-operation figures, given ops operations in all
+    void report(size_t ops)
+    {
+        counted_ += allocations - start_;
+        start_ = allocations;
+        state_.counters["allocs/op"] = double(counted_) / double(ops);
+        state_.counters["time/op"] = benchmark::Counter(
+            double(ops), benchmark::Counter::kIsRate
+                         | benchmark::Counter::kInvert);
+        state_.SetBytesProcessed(int64_t(ops));
+    }
+
+private:
+    benchmark::State& state_;
+    size_t counted_;    // Allocations counted so far
+    size_t start_;      // Value of allocations when counting resumed
+};
+
+//--------------------------------------------------
+//           STRING TYPES
+//--------------------------------------------------
+
+typedef BasicChunkyString<char, 32> ChunkyString32;
+typedef BasicChunkyString<char, 128> ChunkyString128;
+
+// A uniform interface over the string types, for the few operations
+// that are spelt differently for each
+
+/// An iterator to the character at pos
+template <typename String>
+typename String::iterator iteratorAt(String& text, size_t pos)
+{
+    return next(text.begin(), pos);
+}
+
+template <size_t ChunkSize>
+typename BasicChunkyString<char, ChunkSize>::iterator
+iteratorAt(BasicChunkyString<char, ChunkSize>& text, size_t pos)
+{
+    return text.iterator_at(pos);
+}
+
+/// Print text to out
+template <typename String>
+void print(ostream& out, const String& text)
+{
+    copy(text.begin(), text.end(), ostreambuf_iterator<char>(out));
+}
+
+void print(ostream& out, const string& text)
+{
+    out << text;
+}
+
+template <size_t ChunkSize>
+void print(ostream& out, const BasicChunkyString<char, ChunkSize>& text)
+{
+    out << text;
+}
+
+/// Report the utilization of text, if it has one
+template <typename String>
+void reportUtilization(benchmark::State&, const String&)
+{
+    // Only ChunkyStrings have a utilization
+}
+
+template <size_t ChunkSize>
+void reportUtilization(benchmark::State& state,
+                       const BasicChunkyString<char, ChunkSize>& text)
+{
+    state.counters["utilization"] = text.utilization();
+}
+
+/// A string of size random letters, built one character at a time
+template <typename String>
+String randomString(size_t size)
+{
+    minstd_rand gen(size);
+    uniform_int_distribution<int> letter('a', 'z');
+    String text;
+    for (size_t i = 0; i < size; ++i) {
+        text.push_back(char(letter(gen)));
+    }
+    return text;
+}
+
+/// A stream buffer that copies what it's given into a small scratch
+/// area, like a file's buffer that is written out for free
+class ScratchBuffer : public streambuf {
+protected:
+    streamsize xsputn(const char* chars, streamsize count) override
+    {
+        for (streamsize left = count; left > 0; ) {
+            streamsize piece = min(left, streamsize(SCRATCH_SIZE));
+            copy(chars, chars + piece, scratch_);
+            chars += piece;
+            left -= piece;
+        }
+        benchmark::DoNotOptimize(scratch_);
+        return count;
+    }
+
+    int_type overflow(int_type c) override
+    {
+        scratch_[0] = traits_type::to_char_type(c);
+        return traits_type::not_eof(c);
+    }
+
+private:
+    static const size_t SCRATCH_SIZE = 64 * 1024;
+    char scratch_[SCRATCH_SIZE];
+};
+
+//--------------------------------------------------
+//           BENCHMARKS
+//--------------------------------------------------
+
+/// Where edits happen, the second argument of the edit benchmarks
+enum Where { FRONT, UNIFORM, BACK };
+
+/// Positions, as fractions of the string's size, for ops edits
+vector<double> editPositions(Where where, size_t ops)
+{
+    mt19937 gen(ops);
+    uniform_real_distribution<double> anywhere(0, 1);
+    vector<double> positions(ops);
+    for (double& position : positions) {
+        position = where == FRONT ? 0 : where == BACK ? 1 : anywhere(gen);
+    }
+    return positions;
+}
+
+/// Edits per iteration of the edit benchmarks
+static const size_t EDITS = 256;
+
+template <typename String>
+void BM_PushBack(benchmark::State& state)
+{
+    size_t size = size_t(state.range(0));
+    AllocationCounter counter(state);
+    String text;
+    for (auto _ : state) {
+        String built;
+        for (size_t i = 0; i < size; ++i) {
+            built.push_back('a' + char(i % 26));
+        }
+        benchmark::DoNotOptimize(built);
+
+        counter.pause();
+        text = move(built);
+        counter.resume();
+    }
+    counter.report(size * state.iterations());
+    reportUtilization(state, text);
+}
+
+template <typename String>
+void BM_Insert(benchmark::State& state)
+{
+    String original = randomString<String>(size_t(state.range(0)));
+    vector<double> positions = editPositions(Where(state.range(1)), EDITS);
+    AllocationCounter counter(state);
+    String text;
+    for (auto _ : state) {
+        counter.pause();
+        text = original;
+        iteratorAt(text, 0);    // ChunkyString builds its index here
+        counter.resume();
+
+        for (double position : positions) {
+            size_t pos = size_t(position * double(text.size()));
+            text.insert(iteratorAt(text, pos), 'X');
+        }
+    }
+    counter.report(EDITS * state.iterations());
+    reportUtilization(state, text);
+}
+
+template <typename String>
+void BM_Erase(benchmark::State& state)
+{
+    String original = randomString<String>(size_t(state.range(0)));
+    vector<double> positions = editPositions(Where(state.range(1)), EDITS);
+    AllocationCounter counter(state);
+    String text;
+    for (auto _ : state) {
+        counter.pause();
+        text = original;
+        iteratorAt(text, 0);    // ChunkyString builds its index here
+        counter.resume();
+
+        for (double position : positions) {
+            size_t pos = min(size_t(position * double(text.size())),
+                             text.size() - 1);
+            text.erase(iteratorAt(text, pos));
+        }
+    }
+    counter.report(EDITS * state.iterations());
+    reportUtilization(state, text);
+}
+
+template <typename String>
+void BM_Equal(benchmark::State& state)
+{
+    size_t size = size_t(state.range(0));
+    String lhs = randomString<String>(size);
+    String rhs = lhs;
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lhs == rhs);
+    }
+    counter.report(size * state.iterations());
+}
+
+template <typename String>
+void BM_Iterate(benchmark::State& state)
+{
+    size_t size = size_t(state.range(0));
+    const String text = randomString<String>(size);
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        unsigned sum = 0;
+        for (char c : text) {
+            sum += (unsigned char)c;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    counter.report(size * state.iterations());
+}
+
+template <typename String>
+void BM_Output(benchmark::State& state)
+{
+    size_t size = size_t(state.range(0));
+    const String text = randomString<String>(size);
+    ScratchBuffer scratch;
+    ostream out(&scratch);
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        print(out, text);
+    }
+    counter.report(size * state.iterations());
+}
+
+/// Transmit a message of range(0) characters with noise range(1)/1000,
+/// sampling each character if range(2) is 0 and skipping otherwise
+void BM_Transmit(benchmark::State& state)
+{
+    ChunkyString original = randomString<ChunkyString>(
+        size_t(state.range(0)));
+    NoisyTransmission line(float(state.range(1)) / 1000, 1,
+                           state.range(2) == 0
+                               ? NoisyTransmission::Sampling::EACH_CHARACTER
+                               : NoisyTransmission::Sampling::GEOMETRIC_SKIP,
+                           NoisyTransmission::Generator::XOSHIRO256PP);
+    AllocationCounter counter(state);
+    ChunkyString message;
+    for (auto _ : state) {
+        counter.pause();
+        message = original;
+        counter.resume();
+
+        line.transmit(message);
+    }
+    counter.report(original.size() * state.iterations());
+    reportUtilization(state, message);
+}
+
+//--------------------------------------------------
+//           REGISTRATION
+//--------------------------------------------------
+
+void sizes(benchmark::internal::Benchmark* bench)
+{
+    bench->ArgName("size")->RangeMultiplier(32)->Range(1 << 10, 1 << 20);
+}
+
+void editSizes(benchmark::internal::Benchmark* bench)
+{
+    bench->ArgNames({"size", "where"});
+    for (int size = 1 << 10; size <= 1 << 18; size *= 16) {
+        for (int where : {FRONT, UNIFORM, BACK}) {
+            bench->Args({size, where});
+        }
+    }
+}
+
+#define BENCHMARK_STRINGS(func, args)                          \
+    BENCHMARK_TEMPLATE(func, ChunkyString)->Apply(args);       \
+    BENCHMARK_TEMPLATE(func, ChunkyString32)->Apply(args);     \
+    BENCHMARK_TEMPLATE(func, ChunkyString128)->Apply(args);    \
+    BENCHMARK_TEMPLATE(func, string)->Apply(args);             \
+    BENCHMARK_TEMPLATE(func, deque<char>)->Apply(args);        \
+    BENCHMARK_TEMPLATE(func, list<char>)->Apply(args)
+
+BENCHMARK_STRINGS(BM_PushBack, sizes);
+BENCHMARK_STRINGS(BM_Insert, editSizes);
+BENCHMARK_STRINGS(BM_Erase, editSizes);
+BENCHMARK_STRINGS(BM_Equal, sizes);
+BENCHMARK_STRINGS(BM_Iterate, sizes);
+BENCHMARK_STRINGS(BM_Output, sizes);
+
+BENCHMARK(BM_Transmit)
+    ->ArgNames({"size", "noise", "skip"})
+    ->ArgsProduct({{1 << 20}, {1, 10, 100}, {0, 1}});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,64 @@
+/*********************************************************************
+ * BoundedQueue class template.
+ *********************************************************************
+ *
+ * Implementation of the blocking queue declared in bounded-queue.hpp.
+ *
+ */
+
+#include <utility>
+
+template <typename T>
+BoundedQueue<T>::BoundedQueue(size_t capacity)
+    : capacity_{capacity}, closed_{false}
+{
+    // Nothing else to do
+}
+
+template <typename T>
+bool BoundedQueue<T>::push(T item)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    notFull_.wait(lock, [this] {
+        return closed_ || items_.size() < capacity_;
+    });
+    if (closed_)
+    {
+        return false;
+    }
+
+    items_.push_back(std::move(item));
+    lock.unlock();
+    notEmpty_.notify_one();
+    return true;
+}
+
+template <typename T>
+bool BoundedQueue<T>::pop(T& item)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    notEmpty_.wait(lock, [this] {
+        return closed_ || !items_.empty();
+    });
+    if (items_.empty())
+    {
+        return false;
+    }
+
+    item = std::move(items_.front());
+    items_.pop_front();
+    lock.unlock();
+    notFull_.notify_one();
+    return true;
+}
+
+template <typename T>
+void BoundedQueue<T>::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    notFull_.notify_all();
+    notEmpty_.notify_all();
+}
@@ -0,0 +1,68 @@
+/**
+ * \file bounded-queue.hpp
+ *
+ * \brief Declares the BoundedQueue class template, a blocking queue for
+ *        handing work from one thread to another.
+ */
+
+#ifndef BOUNDED_QUEUE_HPP_INCLUDED
+#define BOUNDED_QUEUE_HPP_INCLUDED 1
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+/**
+ * \class BoundedQueue
+ * \brief A first-in, first-out queue that holds at most a fixed number
+ *        of items, shared between the threads of a pipeline.
+ *
+ * \details push waits while the queue is full, so a fast producer is
+ *   held back to the pace of its consumer and the items in flight stay
+ *   bounded.  pop waits while the queue is empty.  Once the producer is
+ *   done it calls close; consumers then drain what is left, after which
+ *   pop reports that there is nothing more to come.
+ *
+ * \tparam T  type of the items; must be movable
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    /// A queue that holds at most capacity items, which must be positive
+    explicit BoundedQueue(size_t capacity);
+
+    // Threads wait on the queue's mutex, it can't be copied or moved
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /**
+     * \brief Add item at the back, waiting until there is room.
+     *
+     * \returns false, without adding item, if the queue has been closed
+     */
+    bool push(T item);
+
+    /**
+     * \brief Move the front item into item, waiting until there is one.
+     *
+     * \returns false, leaving item alone, once the queue is closed and
+     *          empty
+     */
+    bool pop(T& item);
+
+    /// Wake everyone up: pushes fail from now on, pops drain the queue
+    void close();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable notFull_;
+    std::condition_variable notEmpty_;
+    std::deque<T> items_;
+    size_t capacity_;
+    bool closed_;
+};
+
+#include "bounded-queue-private.hpp"
+
+#endif // BOUNDED_QUEUE_HPP_INCLUDED
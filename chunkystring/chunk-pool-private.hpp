@@ -0,0 +1,154 @@
+/*********************************************************************
+ * ChunkPool class template.
+ *********************************************************************
+ *
+ * Implementation of the slab allocator used for ChunkyString's chunks.
+ *
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <new>
+#include <utility>
+
+template <typename Node>
+const size_t ChunkPool<Node>::FIRST_SLAB;
+
+template <typename Node>
+const size_t ChunkPool<Node>::MAX_SLAB;
+
+template <typename Node>
+ChunkPool<Node>::ChunkPool()
+    : free_{nullptr}, freeCount_{0}, nextSlabSize_{FIRST_SLAB}
+{
+    // No slabs until the first Node is needed
+}
+
+template <typename Node>
+void ChunkPool<Node>::swap(ChunkPool& rhs) noexcept
+{
+    using std::swap;
+
+    swap(firstSlab_, rhs.firstSlab_);
+    swap(slabs_, rhs.slabs_);
+    swap(free_, rhs.free_);
+    swap(spareLists_, rhs.spareLists_);
+    swap(freeCount_, rhs.freeCount_);
+    swap(nextSlabSize_, rhs.nextSlabSize_);
+}
+
+template <typename Node>
+void ChunkPool<Node>::absorb(ChunkPool& other)
+{
+    using std::swap;
+
+    // move the shorter list of slabs onto the end of the longer one
+    if (slabs_.size() < other.slabs_.size())
+    {
+        swap(slabs_, other.slabs_);
+    }
+    std::move(other.slabs_.begin(), other.slabs_.end(),
+              std::back_inserter(slabs_));
+    other.slabs_.clear();
+    if (firstSlab_ == nullptr)
+    {
+        swap(firstSlab_, other.firstSlab_);
+    }
+    else if (other.firstSlab_ != nullptr)
+    {
+        slabs_.push_back(std::move(other.firstSlab_));
+    }
+
+    // rather than walk other's free list to join it to ours, set it
+    // aside until ours runs out
+    if (free_ == nullptr)
+    {
+        swap(free_, other.free_);
+    }
+    if (other.free_ != nullptr)
+    {
+        spareLists_.push_back(other.free_);
+        other.free_ = nullptr;
+    }
+    spareLists_.insert(spareLists_.end(), other.spareLists_.begin(),
+                       other.spareLists_.end());
+    other.spareLists_.clear();
+    freeCount_ += other.freeCount_;
+    other.freeCount_ = 0;
+
+    nextSlabSize_ = std::max(nextSlabSize_, other.nextSlabSize_);
+    other.nextSlabSize_ = FIRST_SLAB;
+}
+
+template <typename Node>
+Node* ChunkPool<Node>::allocate()
+{
+    if (free_ == nullptr && !spareLists_.empty())
+    {
+        free_ = spareLists_.back();
+        spareLists_.pop_back();
+    }
+    else if (free_ == nullptr)
+    {
+        grow(nextSlabSize_);
+        if (nextSlabSize_ < MAX_SLAB)
+        {
+            nextSlabSize_ *= 2;
+        }
+    }
+
+    // pop a Slot off the free list and build a Node in it
+    Slot* slot = free_;
+    free_ = slot->next_;
+    --freeCount_;
+    return new (&slot->storage_) Node();
+}
+
+template <typename Node>
+void ChunkPool<Node>::deallocate(Node* node)
+{
+    // Node is trivially destructible, so its storage can simply be reused
+    Slot* slot = reinterpret_cast<Slot*>(node);
+    slot->next_ = free_;
+    free_ = slot;
+    ++freeCount_;
+}
+
+template <typename Node>
+void ChunkPool<Node>::reserve(size_t count)
+{
+    // one slab of exactly the shortfall, which leaves the geometric
+    // growth of later slabs alone
+    if (freeCount_ < count)
+    {
+        grow(count - freeCount_);
+    }
+}
+
+template <typename Node>
+size_t ChunkPool<Node>::available() const
+{
+    return freeCount_;
+}
+
+template <typename Node>
+void ChunkPool<Node>::grow(size_t slabSize)
+{
+    std::unique_ptr<Slot[]> slab(new Slot[slabSize]);
+
+    // thread the new Slots onto the free list, lowest address first
+    for (size_t ind = 0; ind < slabSize; ++ind)
+    {
+        slab[ind].next_ = ind + 1 < slabSize ? &slab[ind + 1] : free_;
+    }
+    free_ = &slab[0];
+    if (firstSlab_ == nullptr)
+    {
+        firstSlab_ = std::move(slab);
+    }
+    else
+    {
+        slabs_.push_back(std::move(slab));
+    }
+    freeCount_ += slabSize;
+}
@@ -0,0 +1,114 @@
+/**
+ * \file chunk-pool.hpp
+ *
+ * \brief Declares the ChunkPool class template, a slab allocator for the
+ *        chunks of a ChunkyString.
+ */
+
+#ifndef CHUNK_POOL_HPP_INCLUDED
+#define CHUNK_POOL_HPP_INCLUDED 1
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+/**
+ * \class ChunkPool
+ * \brief Hands out storage for Nodes from a few large slabs.
+ *
+ * \details Slabs are allocated with geometrically growing sizes and are
+ *   only released when the pool is destroyed.  Deallocated Nodes go on a
+ *   free list and are handed out again before any new slab is carved up,
+ *   so a string that keeps inserting and erasing settles into doing no
+ *   heap allocation at all.
+ *
+ * \tparam Node  type being allocated; must be trivially destructible,
+ *               since the pool never runs destructors when it releases
+ *               its slabs
+ */
+template <typename Node>
+class ChunkPool {
+    static_assert(std::is_trivially_destructible<Node>::value,
+                  "slabs are freed without destroying their Nodes");
+
+public:
+    /**
+     * \brief Default constructor
+     *
+     * \note constant time, allocates nothing
+     */
+    ChunkPool();
+
+    ~ChunkPool() = default;
+
+    // Pools own memory that live Nodes point into, they can't be copied
+    ChunkPool(const ChunkPool&) = delete;
+    ChunkPool& operator=(const ChunkPool&) = delete;
+
+    /// Exchange slabs with rhs \note constant time, never throws
+    void swap(ChunkPool& rhs) noexcept;
+
+    /**
+     * \brief Take over all of other's slabs, and the Nodes in them.
+     *
+     * \details Nodes other handed out stay where they are, but belong to
+     *   this pool from now on; other is left empty.
+     *
+     * \note linear in the number of slabs of the smaller pool
+     */
+    void absorb(ChunkPool& other);
+
+    /**
+     * \brief Default-constructs a Node in storage owned by the pool.
+     *
+     * \note amortized constant time
+     */
+    Node* allocate();
+
+    /**
+     * \brief Returns a Node obtained from allocate() to the free list.
+     *
+     * \note constant time
+     */
+    void deallocate(Node* node);
+
+    /**
+     * \brief Make sure the next count calls to allocate() don't need a
+     *        new slab, carving any shortfall out of a single slab.
+     *
+     * \note linear in the number of Nodes added
+     */
+    void reserve(size_t count);
+
+    /// Number of Nodes allocate() can hand out before it needs a new slab
+    /// \note constant time
+    size_t available() const;
+
+private:
+    /// A cell in a slab, holding either a live Node or a free-list link
+    union Slot {
+        Slot* next_;
+        typename std::aligned_storage<sizeof(Node),
+                                      alignof(Node)>::type storage_;
+    };
+
+    static const size_t FIRST_SLAB = 4;     ///< Slots in the first slab
+    static const size_t MAX_SLAB = 1024;    ///< Slots in the biggest slabs
+
+    /// Allocate a new slab of slabSize Slots and put them all on the free
+    /// list.
+    void grow(size_t slabSize);
+
+    std::unique_ptr<Slot[]> firstSlab_;   // Outside slabs_, so one slab
+                                          // is one allocation
+    std::vector<std::unique_ptr<Slot[]>> slabs_;
+    Slot* free_;            // First unused Slot, or nullptr
+    std::vector<Slot*> spareLists_;   // Absorbed free lists, used up next
+    size_t freeCount_;      // Slots on free_ and the spare lists
+    size_t nextSlabSize_;   // Number of Slots the next slab will have
+};
+
+#include "chunk-pool-private.hpp"
+
+#endif // CHUNK_POOL_HPP_INCLUDED
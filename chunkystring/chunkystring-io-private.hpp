@@ -0,0 +1,188 @@
+/*********************************************************************
+ * ChunkyString file-descriptor I/O.
+ *********************************************************************
+ *
+ * Implementation of the functions declared in chunkystring-io.hpp.
+ *
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <limits>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024    // the POSIX minimum is 16, but Linux and BSD allow 1024
+#endif
+
+template <size_t ChunkSize>
+void readFrom(int fd, BasicChunkyString<char, ChunkSize>& text)
+{
+    readFrom(fd, text, std::numeric_limits<size_t>::max());
+}
+
+template <size_t ChunkSize>
+size_t readFrom(int fd, BasicChunkyString<char, ChunkSize>& text,
+                size_t limit)
+{
+    // big enough to amortize the system calls, small enough to stay
+    // in cache on its way into the Chunks
+    const size_t BLOCK_SIZE = 64 * 1024;
+    std::unique_ptr<char[]> block(new char[BLOCK_SIZE]);
+
+    size_t total = 0;
+    while (total < limit)
+    {
+        ssize_t got = ::read(fd, block.get(),
+                             std::min(BLOCK_SIZE, limit - total));
+        if (got == 0)
+        {
+            break;
+        }
+        if (got < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "read");
+        }
+        text.insert(text.end(), block.get(), size_t(got));
+        total += size_t(got);
+    }
+    return total;
+}
+
+template <typename String>
+String readFile(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), path);
+    }
+
+    String text;
+    try
+    {
+        // the size is only a hint; a file that grows is read to its end
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode))
+        {
+            text.reserve(size_t(info.st_size));
+        }
+        readFrom(fd, text);
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    return text;
+}
+
+template <typename String>
+String mapFile(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), path);
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) < 0)
+    {
+        int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), path);
+    }
+
+    String text;
+    size_t length = size_t(info.st_size);
+    if (length == 0)
+    {
+        // mmap refuses empty mappings
+        ::close(fd);
+        return text;
+    }
+
+    // writable but private, so writes through the string stay in memory
+    void* chars = ::mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE, fd, 0);
+    int error = errno;
+    ::close(fd);
+    if (chars == MAP_FAILED)
+    {
+        throw std::system_error(error, std::generic_category(), path);
+    }
+
+    std::shared_ptr<void> mapping(chars, [length](void* addr) {
+        ::munmap(addr, length);
+    });
+    text.borrow(static_cast<char*>(chars), length, std::move(mapping));
+    return text;
+}
+
+template <size_t ChunkSize>
+void writeTo(int fd, const BasicChunkyString<char, ChunkSize>& text)
+{
+    using string_type = BasicChunkyString<char, ChunkSize>;
+    using segment_iterator = typename string_type::const_segment_iterator;
+
+    std::vector<iovec> batch;
+    batch.reserve(IOV_MAX);
+
+    segment_iterator next = text.segments().begin();
+    segment_iterator end = text.segments().end();
+    while (next != end)
+    {
+        batch.clear();
+        for (; next != end && batch.size() < size_t(IOV_MAX); ++next)
+        {
+            typename string_type::const_segment seg = *next;
+            batch.push_back(iovec{const_cast<char*>(seg.data()),
+                                  seg.size()});
+        }
+
+        // writev may stop part way through, so drop whatever it took
+        // and go again until the batch is empty
+        iovec* first = batch.data();
+        iovec* last = first + batch.size();
+        while (first != last)
+        {
+            ssize_t written = ::writev(fd, first, int(last - first));
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(),
+                                        "writev");
+            }
+
+            size_t left = size_t(written);
+            while (first != last && left >= first->iov_len)
+            {
+                left -= first->iov_len;
+                ++first;
+            }
+            if (first != last)
+            {
+                first->iov_base = static_cast<char*>(first->iov_base) + left;
+                first->iov_len -= left;
+            }
+        }
+    }
+}
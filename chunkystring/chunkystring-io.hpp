@@ -0,0 +1,87 @@
+/**
+ * \file chunkystring-io.hpp
+ *
+ * \brief Bulk input and output for ChunkyStrings through POSIX file
+ *        descriptors, bypassing iostreams.
+ */
+
+#ifndef CHUNKYSTRING_IO_HPP_INCLUDED
+#define CHUNKYSTRING_IO_HPP_INCLUDED 1
+
+#include <cstddef>
+#include <string>
+
+#include "chunkystring.hpp"
+
+/**
+ * \brief Append everything that can be read from the file descriptor
+ *        fd to text.
+ *
+ * \details Reads in large blocks, each copied into text's Chunks with a
+ *   single range insert, and carries on after EINTR.
+ *
+ * \throws std::system_error  if a read fails
+ */
+template <size_t ChunkSize>
+void readFrom(int fd, BasicChunkyString<char, ChunkSize>& text);
+
+/**
+ * \brief Append the next limit characters that can be read from the file
+ *        descriptor fd to text.
+ *
+ * \details Keeps reading through short reads, so it only stops early at
+ *   end of file, which makes it suitable for cutting a pipe into
+ *   fixed-size blocks.
+ *
+ * \returns the number of characters appended, less than limit only at
+ *          end of file
+ *
+ * \throws std::system_error  if a read fails
+ */
+template <size_t ChunkSize>
+size_t readFrom(int fd, BasicChunkyString<char, ChunkSize>& text,
+                size_t limit);
+
+/**
+ * \brief Build a string from the contents of the file at path.
+ *
+ * \details Room for the whole file is reserved up front, from its size,
+ *   so a regular file is read into a single slab of Chunks.
+ *
+ * \throws std::system_error  if the file can't be opened or read
+ */
+template <typename String = ChunkyString>
+String readFile(const std::string& path);
+
+/**
+ * \brief Build a string that borrows the contents of the file at path
+ *        instead of copying them.
+ *
+ * \details The file is mapped privately, so the string reads it
+ *   straight from the page cache and only the pages it writes to, and
+ *   the parts insert and erase copy out, take up memory of their own.
+ *   The file must not be truncated while the string uses it.
+ *
+ * \throws std::system_error  if the file can't be opened or mapped
+ *
+ * \see BasicChunkyString::borrow
+ */
+template <typename String = ChunkyString>
+String mapFile(const std::string& path);
+
+/**
+ * \brief Write all of text to the file descriptor fd.
+ *
+ * \details Hands the string's segments to writev(2), up to IOV_MAX
+ *   Chunks per call, and carries on after short writes and EINTR.
+ *   Anything buffered in an iostream attached to the same descriptor
+ *   must be flushed first.
+ *
+ * \throws std::system_error  if a write fails
+ */
+template <size_t ChunkSize>
+void writeTo(int fd, const BasicChunkyString<char, ChunkSize>& text);
+
+#include "chunkystring-io-private.hpp"
+
+#endif // CHUNKYSTRING_IO_HPP_INCLUDED
@@ -0,0 +1,2010 @@
+/*********************************************************************
+ * BasicChunkyString class template.
+ *********************************************************************
+ *
+ * Implementation of BasicChunkyString and its private Chunk class.
+ * Included from chunkystring.hpp, since templates must be visible
+ * wherever they are instantiated.
+ *
+ * \authors Ricky Pan, Iris Liu
+ */
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+template <typename CharT, size_t ChunkSize>
+const size_t BasicChunkyString<CharT, ChunkSize>::CHUNKSIZE;
+
+template <typename CharT, size_t ChunkSize>
+const size_t BasicChunkyString<CharT, ChunkSize>::SMALL_SIZE;
+
+template <typename CharT, size_t ChunkSize>
+const size_t BasicChunkyString<CharT, ChunkSize>::MAX_SHIFT;
+
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>::BasicChunkyString()
+    : size_{0}, chunkCount_{0}, edits_{0}
+{
+    // head_ starts out as an empty list, and local_ isn't in it yet
+    local_.chars_ = small_;
+}
+
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>::BasicChunkyString(
+                                            const BasicChunkyString& orig)
+    : size_{0}, chunkCount_{0}, policy_{orig.policy_}, edits_{0}
+{
+    local_.chars_ = small_;
+
+    // a copy is packed full, so its Chunks fit in one slab
+    reserve(orig.size_);
+    appendChunks(orig);
+}
+
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>::BasicChunkyString(
+                                            BasicChunkyString&& orig) noexcept
+    : size_{0}, chunkCount_{0}, edits_{0}
+{
+    local_.chars_ = small_;
+
+    // take orig's Chunks and pool, leaving it our empty list
+    swap(orig);
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::swap(
+                                            BasicChunkyString& rhs) noexcept
+{
+    using std::swap;
+
+    // each head keeps its own anchor_, so trade the rest field by field
+    swap(head_.prev_, rhs.head_.prev_);
+    swap(head_.next_, rhs.head_.next_);
+    swap(head_.root_, rhs.head_.root_);
+    swap(head_.indexed_, rhs.head_.indexed_);
+    swap(head_.seed_, rhs.head_.seed_);
+    swap(size_, rhs.size_);
+    swap(chunkCount_, rhs.chunkCount_);
+    swap(policy_, rhs.policy_);
+    swap(edits_, rhs.edits_);
+    swap(owners_, rhs.owners_);
+    pool_.swap(rhs.pool_);
+    nodes_.swap(rhs.nodes_);
+
+    // local_ can't change hands, so trade what is in it
+    CharT chars[SMALL_SIZE];
+    std::copy(small_, small_ + local_.length_, chars);
+    std::copy(rhs.small_, rhs.small_ + rhs.local_.length_, small_);
+    std::copy(chars, chars + local_.length_, rhs.small_);
+    swap(local_.length_, rhs.local_.length_);
+    swap(local_.node_, rhs.local_.node_);
+
+    // the end Chunks and the index root still point at the other
+    // string's sentinel, and a small string at the other's local_
+    for (BasicChunkyString* str : {this, &rhs})
+    {
+        BasicChunkyString* other = str == this ? &rhs : this;
+        if (str->chunkCount_ == 0)
+        {
+            str->resetHead();
+        }
+        else if (str->head_.next_ == &other->local_)
+        {
+            str->head_.next_ = &str->local_;
+            str->head_.prev_ = &str->local_;
+            str->local_.prev_ = &str->head_;
+            str->local_.next_ = &str->head_;
+            if (str->local_.node_ != nullptr)
+            {
+                str->local_.node_->link_ = &str->local_;
+            }
+        }
+        else
+        {
+            str->head_.next_->prev_ = &str->head_;
+            str->head_.prev_->next_ = &str->head_;
+        }
+
+        if (str->head_.root_ != nullptr)
+        {
+            str->head_.root_->parent_ = &str->head_.anchor_;
+        }
+    }
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::iterator
+    BasicChunkyString<CharT, ChunkSize>::begin()
+{
+    return iterator(head_.next_, 0);
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::iterator
+    BasicChunkyString<CharT, ChunkSize>::end()
+{
+    return iterator(&head_, 0);
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::const_iterator
+    BasicChunkyString<CharT, ChunkSize>::begin() const
+{
+    return const_iterator(head_.next_, 0);
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::const_iterator
+    BasicChunkyString<CharT, ChunkSize>::end() const
+{
+    return const_iterator(&head_, 0);
+}
+
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>&
+    BasicChunkyString<CharT, ChunkSize>::operator+=(
+                                            const BasicChunkyString& rhs)
+{
+    appendChunks(rhs);
+    return *this;
+}
+
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>&
+    BasicChunkyString<CharT, ChunkSize>::operator+=(BasicChunkyString&& rhs)
+{
+    if (&rhs == this)
+    {
+        // a string can't be spliced into itself, so copy
+        appendChunks(rhs);
+    }
+    else
+    {
+        splice(end(), rhs);
+    }
+    return *this;
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::push_back(CharT c)
+{
+    // short strings keep their characters in the string object
+    if (makeSmall(size_ + 1))
+    {
+        small_[size_] = c;
+        setLength(&local_, local_.length_ + 1);
+        ++size_;
+        return;
+    }
+    promote(end());
+
+    // adds a char c to the end of our ChunkyString
+    if (chunkCount_ == 0 || isFull(lastChunk()))
+    {
+        // link a new Chunk in at the end of the list
+        insertChunk(&head_);
+    }
+
+    // place in next available array index
+    Chunk* last = lastChunk();
+    last->chars_[last->length_] = c;
+    setLength(last, last->length_ + 1);
+    ++size_;
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::iterator
+    BasicChunkyString<CharT, ChunkSize>::insert(iterator i, CharT c)
+{
+    if(makeSmall(size_ + 1))
+    {
+        size_t ind = i == end() ? size_ : i.charInd_;
+        *growSmall(ind, 1) = c;
+        return compact(iterator(&local_, ind));
+    }
+    i = promote(i);
+
+    // if iterator points to end
+    if(i==end())
+    {
+        // use predefined function push_back()
+        push_back(c);
+        iterator toReturn = end();
+        --toReturn;
+        return compact(toReturn);
+    }
+
+    i = own(i);
+    Chunk* chunk = i.chunk();
+    size_t before = i.charInd_;
+    size_t after = chunk->length_ - before;
+
+    // make room by moving the shorter side of i
+    if(before <= after)
+    {
+        // the characters in front go to the end of the previous Chunk,
+        // or to a new one if there are too many to shift; either way the
+        // free cells of both Chunks meet at i, ready for the next edit
+        if(policy_.openGaps && roomBefore(chunk) <= before
+           && worthSplitting(before))
+        {
+            insertChunk(chunk);
+        }
+        if(policy_.openGaps && roomBefore(chunk) > before)
+        {
+            shiftToPrevious(chunk, before);
+            Chunk* prevChunk = static_cast<Chunk*>(chunk->prev_);
+            prevChunk->chars_[prevChunk->length_] = c;
+            setLength(prevChunk, prevChunk->length_ + 1);
+            ++size_;
+            return compact(iterator(prevChunk, prevChunk->length_ - 1));
+        }
+        if(frontRoom(chunk) > 0)
+        {
+            --chunk->chars_;
+            std::copy(chunk->chars_ + 1, chunk->chars_ + 1 + before,
+                      chunk->chars_);
+            chunk->chars_[before] = c;
+            setLength(chunk, chunk->length_ + 1);
+            ++size_;
+            return compact(i);
+        }
+    }
+    else if(policy_.openGaps && worthSplitting(after))
+    {
+        // likewise, the characters behind go to a new Chunk
+        splitChunk(chunk, before);
+    }
+    else if(backRoom(chunk) == 0)
+    {
+        settle(chunk);
+    }
+
+    // if current Chunk is full
+    if(backRoom(chunk) == 0)
+    {
+        // the first half stays put, the second half moves to a new Chunk
+        // placed right after the current one
+        const size_t keep = ChunkSize/2;
+        Chunk* nextChunk = splitChunk(chunk, keep);
+
+        // check to see if iterator changed from copying elements
+        if(i.charInd_ > keep)
+        {
+            i = iterator(nextChunk, i.charInd_ - keep);
+        }
+    }
+
+    // inserts char c into the proper space in the Chunk's char[]
+    helperInsert(i, c);
+
+    ++size_;
+    return compact(i);
+}
+
+template <typename CharT, size_t ChunkSize>
+template <typename InputIt>
+typename BasicChunkyString<CharT, ChunkSize>::iterator
+    BasicChunkyString<CharT, ChunkSize>::insert(iterator i, InputIt first,
+                                                InputIt last)
+{
+    using category =
+        typename std::iterator_traits<InputIt>::iterator_category;
+
+    if(first == last)
+    {
+        return i;
+    }
+
+    // only random-access ranges are measured, others go to Chunks
+    size_t remaining = rangeLength(first, last, category());
+    if(remaining > 0 && makeSmall(size_ + remaining))
+    {
+        size_t ind = i == end() ? size_ : i.charInd_;
+        std::copy(first, last, growSmall(ind, remaining));
+        return compact(iterator(&local_, ind));
+    }
+    i = promote(i);
+
+    // find the Chunk and cell the new text starts at; at the end of the
+    // string that is the free space in the last Chunk, if there is any
+    Chunk* chunk;
+    size_t start;
+    if(i == end())
+    {
+        if(chunkCount_ == 0 || isFull(lastChunk()))
+        {
+            insertChunk(&head_);
+        }
+        chunk = lastChunk();
+        start = chunk->length_;
+    }
+    else
+    {
+        i = own(i);
+        chunk = i.chunk();
+        start = i.charInd_;
+        settle(chunk);
+    }
+
+    // set aside the characters that follow the insertion point
+    CharT tail[ChunkSize];
+    size_t tailLength = chunk->length_ - start;
+    std::copy(chunk->chars_ + start, chunk->chars_ + chunk->length_, tail);
+    setLength(chunk, start);
+
+    // top up the first Chunk, then add full Chunks until we run out
+    size_t inserted = fillChunk(chunk, first, last, remaining, category());
+    Chunk* tailChunk = chunk;
+    while(first != last)
+    {
+        tailChunk = insertChunk(tailChunk->next_);
+        inserted += fillChunk(tailChunk, first, last, remaining,
+                              category());
+    }
+    size_ += inserted;
+
+    iterator toReturn(chunk, start);
+
+    // put the tail back, splitting it off if it doesn't fit
+    if(tailChunk->length_ + tailLength <= ChunkSize)
+    {
+        std::copy(tail, tail + tailLength, tailChunk->chars_ + tailChunk->length_);
+        setLength(tailChunk, tailChunk->length_ + tailLength);
+    }
+    else
+    {
+        // even out tailChunk and the new Chunk so both are at least half full
+        Chunk* extra = insertChunk(tailChunk->next_);
+        size_t length = tailChunk->length_;
+        size_t keep = (length + tailLength + 1)/2;
+
+        if(keep <= length)
+        {
+            // some of the new text moves on, ahead of the tail
+            std::copy(tailChunk->chars_ + keep, tailChunk->chars_ + length,
+                      extra->chars_);
+            std::copy(tail, tail + tailLength, extra->chars_ + length - keep);
+        }
+        else
+        {
+            // the front of the tail stays behind
+            std::copy(tail, tail + keep - length, tailChunk->chars_ + length);
+            std::copy(tail + keep - length, tail + tailLength, extra->chars_);
+        }
+        setLength(extra, length + tailLength - keep);
+        setLength(tailChunk, keep);
+
+        if(tailChunk == chunk && start >= keep)
+        {
+            toReturn = iterator(extra, start - keep);
+        }
+    }
+
+    return compact(toReturn);
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::iterator
+    BasicChunkyString<CharT, ChunkSize>::insert(iterator i,
+                                                const CharT* chars,
+                                                size_t count)
+{
+    return insert(i, chars, chars + count);
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::iterator
+    BasicChunkyString<CharT, ChunkSize>::erase(iterator i)
+{
+    if(i == end())
+    {
+        std::cout << "Invalid iterator, please try again" << std::endl;
+        return i;
+    }
+
+    // borrowed characters never need copying to be erased
+    if(i.chunk()->borrowed())
+    {
+        iterator next = i;
+        return erase(i, ++next);
+    }
+
+    // close up the shorter side of i
+    Chunk* chunk = i.chunk();
+    size_t before = i.charInd_;
+    size_t after = chunk->length_ - before - 1;
+    if(before <= after)
+    {
+        // the characters in front go to the end of the previous Chunk, or
+        // to a new one if there are too many to shift, which leaves the
+        // free cells of both Chunks at i
+        if(policy_.openGaps && roomBefore(chunk) < before
+           && worthSplitting(before))
+        {
+            insertChunk(chunk);
+        }
+        if(policy_.openGaps && before > 0 && roomBefore(chunk) >= before)
+        {
+            shiftToPrevious(chunk, before);
+            i = iterator(chunk, 0);
+        }
+        else
+        {
+            std::copy_backward(chunk->chars_, chunk->chars_ + before,
+                               chunk->chars_ + before + 1);
+        }
+        ++chunk->chars_;
+    }
+    else if(policy_.openGaps && worthSplitting(after))
+    {
+        // likewise, the characters behind go to a new Chunk
+        splitChunk(chunk, before + 1);
+    }
+    else
+    {
+        std::copy(chunk->chars_ + before + 1,
+                  chunk->chars_ + chunk->length_, chunk->chars_ + before);
+    }
+    setLength(chunk, chunk->length_ - 1);
+    --size_;
+
+    if(chunk->length_ == 0)
+    {
+        // erase the now empty chunk, iterator moves to the next one
+        return compact(iterator(eraseChunk(i.chunk_), 0));
+    }
+
+    // keep every Chunk at least minFill full
+    if(chunk->length_ < policy_.minFill)
+    {
+        i = reflow(i);
+    }
+
+    // if we erased the last char in a Chunk, move on to the next Chunk
+    if(i.charInd_ == i.chunk()->length_)
+    {
+        i.chunk_ = i.chunk_->next_;
+        i.charInd_ = 0;
+    }
+
+    return compact(i);
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::iterator
+    BasicChunkyString<CharT, ChunkSize>::erase(iterator first, iterator last)
+{
+    if(first == last)
+    {
+        return last;
+    }
+
+    if(isSmall())
+    {
+        // close the gap in small_; an empty string drops local_
+        size_t from = first.charInd_;
+        size_t to = last == end() ? size_ : last.charInd_;
+        std::copy(small_ + to, small_ + size_, small_ + from);
+        setLength(&local_, local_.length_ - (to - from));
+        size_ -= to - from;
+        if(size_ == 0)
+        {
+            eraseChunk(&local_);
+        }
+        return compact(from == size_ ? end() : iterator(&local_, from));
+    }
+
+    Chunk* front = first.chunk();
+
+    if(first.chunk_ == last.chunk_ && front->borrowed())
+    {
+        // rather than shift borrowed characters, split the run in two
+        size_t rest = front->length_ - last.charInd_;
+        if(rest > 0)
+        {
+            Chunk* back = insertChunk(front->next_);
+            back->chars_ = front->chars_ + last.charInd_;
+            setLength(back, rest);
+        }
+        setLength(front, first.charInd_);
+        size_ -= last.charInd_ - first.charInd_;
+    }
+    else if(first.chunk_ == last.chunk_)
+    {
+        // the range sits inside a single Chunk, shift the rest down
+        std::copy(front->chars_ + last.charInd_,
+                  front->chars_ + front->length_,
+                  front->chars_ + first.charInd_);
+        setLength(front, front->length_ - (last.charInd_ - first.charInd_));
+        size_ -= last.charInd_ - first.charInd_;
+    }
+    else
+    {
+        // keep the front Chunk's prefix...
+        size_t removed = front->length_ - first.charInd_;
+        setLength(front, first.charInd_);
+
+        // ...unlink every Chunk that is entirely inside the range...
+        ChunkLink* link = front->next_;
+        while(link != last.chunk_)
+        {
+            removed += static_cast<Chunk*>(link)->length_;
+            link = eraseChunk(link);
+        }
+
+        // ...and keep the back Chunk's suffix
+        if(last != end())
+        {
+            // the suffix stays where it is, borrowed or not
+            Chunk* back = last.chunk();
+            back->chars_ += last.charInd_;
+            setLength(back, back->length_ - last.charInd_);
+            removed += last.charInd_;
+        }
+        size_ -= removed;
+    }
+
+    // i sits just past the front Chunk's prefix, which reflow keeps
+    // pointing at the first character after the range
+    iterator i(front, first.charInd_);
+    if(front->length_ == 0)
+    {
+        i = iterator(eraseChunk(front), 0);
+    }
+    else if(front->length_ < policy_.minFill)
+    {
+        i = reflow(i);
+    }
+
+    if(i != end() && i.charInd_ == i.chunk()->length_)
+    {
+        i.chunk_ = i.chunk_->next_;
+        i.charInd_ = 0;
+    }
+
+    // the back Chunk may be the one left almost empty
+    if(i != end() && i.chunk()->length_ < policy_.minFill)
+    {
+        i = reflow(i);
+    }
+
+    // if we erased up to the end of a Chunk, move on to the next Chunk
+    if(i != end() && i.charInd_ == i.chunk()->length_)
+    {
+        i.chunk_ = i.chunk_->next_;
+        i.charInd_ = 0;
+    }
+
+    return compact(i);
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::iterator
+    BasicChunkyString<CharT, ChunkSize>::reflow(iterator i)
+{
+    Chunk* current = i.chunk();
+
+    // borrowed Chunks hold no storage of their own, so there is nothing
+    // to gain by merging with them
+    if(current->borrowed())
+    {
+        return i;
+    }
+    settle(current);
+
+    // try to append the current Chunk to the previous one
+    if(current->prev_ != &head_)
+    {
+        Chunk* prevChunk = static_cast<Chunk*>(current->prev_);
+
+        if(!prevChunk->borrowed()
+           && prevChunk->length_ + current->length_ <= ChunkSize)
+        {
+            settle(prevChunk);
+            std::copy(current->chars_, current->chars_ + current->length_,
+                      prevChunk->chars_ + prevChunk->length_);
+
+            // fix iterator
+            iterator toReturn(prevChunk, prevChunk->length_ + i.charInd_);
+
+            // accounts for the change in length from adding chars
+            setLength(prevChunk, prevChunk->length_ + current->length_);
+            eraseChunk(current);
+
+            return toReturn;
+        }
+    }
+
+    if(current->next_ == &head_)
+    {
+        // the only Chunk may be as empty as it likes
+        if(current->prev_ == &head_
+           || static_cast<Chunk*>(current->prev_)->borrowed())
+        {
+            return i;
+        }
+
+        // borrow from the back of the previous Chunk instead
+        Chunk* prevChunk = static_cast<Chunk*>(current->prev_);
+        size_t moved = (prevChunk->length_ - current->length_)/2;
+
+        std::copy_backward(current->chars_,
+                           current->chars_ + current->length_,
+                           current->chars_ + current->length_ + moved);
+        std::copy(prevChunk->chars_ + prevChunk->length_ - moved,
+                  prevChunk->chars_ + prevChunk->length_,
+                  current->chars_);
+        setLength(prevChunk, prevChunk->length_ - moved);
+        setLength(current, current->length_ + moved);
+
+        return iterator(current, i.charInd_ + moved);
+    }
+
+    Chunk* nextChunk = static_cast<Chunk*>(current->next_);
+
+    if(nextChunk->borrowed())
+    {
+        return i;
+    }
+
+    if(current->length_ + nextChunk->length_ <= ChunkSize)
+    {
+        // pull the next Chunk into the current one
+        std::copy(nextChunk->chars_, nextChunk->chars_ + nextChunk->length_,
+                  current->chars_ + current->length_);
+
+        // accounts for the change in length from adding chars
+        setLength(current, current->length_ + nextChunk->length_);
+        eraseChunk(nextChunk);
+    }
+    else
+    {
+        // borrow from the front of the next Chunk
+        size_t moved = (nextChunk->length_ - current->length_)/2;
+
+        std::copy(nextChunk->chars_, nextChunk->chars_ + moved,
+                  current->chars_ + current->length_);
+        std::copy(nextChunk->chars_ + moved,
+                  nextChunk->chars_ + nextChunk->length_,
+                  nextChunk->chars_);
+        setLength(nextChunk, nextChunk->length_ - moved);
+        setLength(current, current->length_ + moved);
+    }
+
+    // iterator stays the same
+    return i;
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::helperInsert(iterator& i, CharT c)
+{
+    Chunk* chunk = i.chunk();
+
+    // making room for extra element in array by shifting all elements
+    // after insert position down by 1 index
+    std::copy_backward(chunk->chars_ + i.charInd_,
+                       chunk->chars_ + chunk->length_,
+                       chunk->chars_ + chunk->length_ + 1);
+
+    // finally, insert the character into the Chunk
+    chunk->chars_[i.charInd_] = c;
+    setLength(chunk, chunk->length_ + 1);
+}
+
+template <typename CharT, size_t ChunkSize>
+size_t BasicChunkyString<CharT, ChunkSize>::size() const
+{
+    return size_;
+}
+
+template <typename CharT, size_t ChunkSize>
+size_t BasicChunkyString<CharT, ChunkSize>::capacity() const
+{
+    if (isSmall() || (chunkCount_ == 0 && pool_.available() == 0))
+    {
+        return SMALL_SIZE;
+    }
+
+    const Chunk* last = static_cast<const Chunk*>(head_.prev_);
+    size_t spare = chunkCount_ == 0 ? 0 : backRoom(last);
+    return size_ + spare + pool_.available()*ChunkSize;
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::reserve(size_t count)
+{
+    if (count <= capacity())
+    {
+        return;
+    }
+
+    if (isSmall())
+    {
+        // the Chunks the characters move into come out of the reserve
+        pool_.reserve((count + ChunkSize - 1)/ChunkSize);
+        promote(end());
+        return;
+    }
+
+    // an empty string's SMALL_SIZE cells aren't in Chunks
+    size_t have = chunkCount_ == 0 ? pool_.available()*ChunkSize
+                                   : capacity();
+    pool_.reserve(pool_.available()
+                  + (count - have + ChunkSize - 1)/ChunkSize);
+}
+
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>&
+    BasicChunkyString<CharT, ChunkSize>::operator=(
+                                            const BasicChunkyString& rhs)
+{
+    // Assignment is implemented idiomatically using the "swap trick"
+    BasicChunkyString copy = rhs;
+    swap(copy);
+    return *this;
+}
+
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>&
+    BasicChunkyString<CharT, ChunkSize>::operator=(
+                                            BasicChunkyString&& rhs) noexcept
+{
+    // Moving into a temporary first leaves rhs empty, and frees our old
+    // Chunks now rather than whenever rhs is destroyed
+    BasicChunkyString moved(std::move(rhs));
+    swap(moved);
+    return *this;
+}
+
+template <typename CharT, size_t ChunkSize>
+bool BasicChunkyString<CharT, ChunkSize>::operator==(
+                                            const BasicChunkyString& rhs) const
+{
+    if(size_ != rhs.size_)
+    {
+        return false;
+    }
+
+    return compare(rhs) == 0;
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::reference
+    BasicChunkyString<CharT, ChunkSize>::at(size_t pos)
+{
+    if (pos >= size_)
+    {
+        throw std::out_of_range("ChunkyString::at");
+    }
+
+    Chunk* chunk = locate(pos);
+    return chunk->chars_[pos];
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::const_reference
+    BasicChunkyString<CharT, ChunkSize>::at(size_t pos) const
+{
+    if (pos >= size_)
+    {
+        throw std::out_of_range("ChunkyString::at");
+    }
+
+    const Chunk* chunk = locate(pos);
+    return chunk->chars_[pos];
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::iterator
+    BasicChunkyString<CharT, ChunkSize>::iterator_at(size_t pos)
+{
+    if (pos > size_)
+    {
+        throw std::out_of_range("ChunkyString::iterator_at");
+    }
+    else if (pos == size_)
+    {
+        return end();
+    }
+
+    Chunk* chunk = locate(pos);
+    return iterator(chunk, pos);
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::const_iterator
+    BasicChunkyString<CharT, ChunkSize>::iterator_at(size_t pos) const
+{
+    if (pos > size_)
+    {
+        throw std::out_of_range("ChunkyString::iterator_at");
+    }
+    else if (pos == size_)
+    {
+        return end();
+    }
+
+    const Chunk* chunk = locate(pos);
+    return const_iterator(chunk, pos);
+}
+
+template <typename CharT, size_t ChunkSize>
+bool BasicChunkyString<CharT, ChunkSize>::operator!=(
+                                            const BasicChunkyString& rhs) const
+{
+    // Idiomatic code: leverage == to implement !=
+    return !(*this == rhs);
+}
+
+template <typename CharT, size_t ChunkSize>
+bool BasicChunkyString<CharT, ChunkSize>::operator<(
+                                            const BasicChunkyString& rhs) const
+{
+    return compare(rhs) < 0;
+}
+
+template <typename CharT, size_t ChunkSize>
+void swap(BasicChunkyString<CharT, ChunkSize>& lhs,
+          BasicChunkyString<CharT, ChunkSize>& rhs) noexcept
+{
+    lhs.swap(rhs);
+}
+
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>
+    operator+(const BasicChunkyString<CharT, ChunkSize>& lhs,
+              const BasicChunkyString<CharT, ChunkSize>& rhs)
+{
+    BasicChunkyString<CharT, ChunkSize> result(lhs);
+    result += rhs;
+    return result;
+}
+
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>
+    operator+(BasicChunkyString<CharT, ChunkSize>&& lhs,
+              const BasicChunkyString<CharT, ChunkSize>& rhs)
+{
+    lhs += rhs;
+    return std::move(lhs);
+}
+
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>
+    operator+(const BasicChunkyString<CharT, ChunkSize>& lhs,
+              BasicChunkyString<CharT, ChunkSize>&& rhs)
+{
+    // lhs's characters have to be copied either way; rhs's needn't be
+    BasicChunkyString<CharT, ChunkSize> result(lhs);
+    result += std::move(rhs);
+    return result;
+}
+
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>
+    operator+(BasicChunkyString<CharT, ChunkSize>&& lhs,
+              BasicChunkyString<CharT, ChunkSize>&& rhs)
+{
+    lhs += std::move(rhs);
+    return std::move(lhs);
+}
+
+template <typename CharT, size_t ChunkSize>
+std::basic_ostream<CharT>& operator<<(std::basic_ostream<CharT>& out,
+                            const BasicChunkyString<CharT, ChunkSize>& text)
+{
+    using const_segment =
+        typename BasicChunkyString<CharT, ChunkSize>::const_segment;
+
+    // one unformatted write per Chunk, rather than a formatted << per
+    // character
+    for (const_segment seg : text.segments())
+    {
+        if (!out.write(seg.data(), seg.size()))
+        {
+            break;
+        }
+    }
+
+    return out;
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::iterator
+    BasicChunkyString<CharT, ChunkSize>::splice(iterator pos,
+                                                BasicChunkyString& other)
+{
+    if (other.chunkCount_ == 0)
+    {
+        return pos;
+    }
+
+    // anything other borrows has to live as long as we do
+    owners_.insert(owners_.end(),
+                   std::make_move_iterator(other.owners_.begin()),
+                   std::make_move_iterator(other.owners_.end()));
+    other.owners_.clear();
+
+    if (other.isSmall())
+    {
+        // other's characters are inside other, so they can't be linked in
+        iterator spliced = insert(pos, other.small_,
+                                  other.small_ + other.size_);
+        other.erase(other.begin(), other.end());
+        return spliced;
+    }
+    pos = promote(pos);
+
+    // other's Chunks go in front of at, so if pos is inside a Chunk,
+    // split its characters from pos on off into a Chunk of their own
+    ChunkLink* at = pos.chunk_;
+    if (pos.charInd_ > 0)
+    {
+        Chunk* front = pos.chunk();
+        Chunk* back = insertChunk(front->next_);
+        if (front->borrowed())
+        {
+            back->chars_ = front->chars_ + pos.charInd_;
+        }
+        else
+        {
+            std::copy(front->chars_ + pos.charInd_,
+                      front->chars_ + front->length_, back->chars_);
+        }
+        setLength(back, front->length_ - pos.charInd_);
+        setLength(front, pos.charInd_);
+        at = back;
+    }
+
+    // the Chunks live in other's slabs, which become ours
+    pool_.absorb(other.pool_);
+
+    ChunkLink* before = at->prev_;
+    Chunk* first = static_cast<Chunk*>(other.head_.next_);
+    Chunk* last = static_cast<Chunk*>(other.head_.prev_);
+    if (head_.indexed_)
+    {
+        // link the Chunks in one at a time, so that each finds its place
+        // in the index between indexed neighbours
+        for (ChunkLink* link = first; link != &other.head_; )
+        {
+            ChunkLink* next = link->next_;
+            link->prev_ = at->prev_;
+            link->next_ = at;
+            at->prev_->next_ = link;
+            at->prev_ = link;
+            indexInsert(static_cast<Chunk*>(link));
+            link = next;
+        }
+    }
+    else
+    {
+        if (other.head_.indexed_)
+        {
+            // Chunks with a node_ would claim to be indexed, and lead
+            // back into other's index
+            for (ChunkLink* link = first; link != &other.head_;
+                 link = link->next_)
+            {
+                link->node_ = nullptr;
+            }
+        }
+        first->prev_ = before;
+        before->next_ = first;
+        last->next_ = at;
+        at->prev_ = last;
+    }
+    size_ += other.size_;
+    chunkCount_ += other.chunkCount_;
+
+    other.size_ = 0;
+    other.chunkCount_ = 0;
+    other.head_.root_ = nullptr;
+    other.head_.indexed_ = false;
+    ChunkPool<IndexNode>().swap(other.nodes_);
+    other.resetHead();
+
+    // merge across the seams where the neighbours fit in one Chunk
+    iterator spliced(first, 0);
+    if (before != &head_)
+    {
+        Chunk* front = static_cast<Chunk*>(before);
+        size_t frontLength = front->length_;
+        if (joinChunks(front, first))
+        {
+            spliced = iterator(front, frontLength);
+        }
+    }
+    if (at != &head_)
+    {
+        joinChunks(static_cast<Chunk*>(at->prev_), static_cast<Chunk*>(at));
+    }
+
+    return spliced;
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::borrow(CharT* chars, size_t count,
+                                                 std::shared_ptr<void> owner)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    promote(end());
+    owners_.push_back(std::move(owner));
+    Chunk* chunk = insertChunk(&head_);
+    chunk->chars_ = chars;
+    setLength(chunk, count);
+    size_ += count;
+}
+
+template <typename CharT, size_t ChunkSize>
+double BasicChunkyString<CharT, ChunkSize>::utilization() const
+{
+    if (isSmall())
+    {
+        size_t chunks = (size_ + ChunkSize - 1)/ChunkSize;
+        return double(size_)/(chunks*ChunkSize);
+    }
+    return double(size_)/(chunkCount_*ChunkSize);
+}
+
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>::CompactionPolicy::CompactionPolicy(
+                                            size_t minFill, double repackBelow,
+                                            bool openGaps)
+    : minFill{minFill}, repackBelow{repackBelow}, openGaps{openGaps}
+{
+    // Nothing else to do
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::CompactionPolicy
+    BasicChunkyString<CharT, ChunkSize>::compaction_policy() const
+{
+    return policy_;
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::set_compaction_policy(
+                                            const CompactionPolicy& policy)
+{
+    // reflow only promises half-full Chunks when it has to borrow
+    if (policy.minFill > ChunkSize/2)
+    {
+        throw std::invalid_argument("ChunkyString: minFill over CHUNKSIZE/2");
+    }
+    if (!(policy.repackBelow >= 0 && policy.repackBelow <= 1))
+    {
+        throw std::invalid_argument(
+            "ChunkyString: repackBelow not between 0 and 1");
+    }
+    policy_ = policy;
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::shrink_to_fit()
+{
+    repack(end());
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::iterator
+    BasicChunkyString<CharT, ChunkSize>::compact(iterator i)
+{
+    // a repack costs about as much as touching every Chunk, so waiting
+    // for as many edits as there are Chunks keeps it constant per edit
+    ++edits_;
+    if (policy_.repackBelow > 0 && chunkCount_ > 0
+        && edits_ >= chunkCount_ && utilization() < policy_.repackBelow)
+    {
+        return repack(i);
+    }
+    return i;
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::iterator
+    BasicChunkyString<CharT, ChunkSize>::repack(iterator keep)
+{
+    // small_ is already as packed as it gets
+    if (isSmall())
+    {
+        return keep;
+    }
+
+    BasicChunkyString packed;
+    packed.policy_ = policy_;
+    iterator kept = packed.end();
+
+    // count the Chunks first, so the new pool is a single slab that
+    // fits exactly
+    size_t chunks = 0;
+    size_t run = 0;     // Owned characters since the last borrowed Chunk
+    for (ChunkLink* link = head_.next_; link != &head_; link = link->next_)
+    {
+        Chunk* chunk = static_cast<Chunk*>(link);
+        if (chunk->borrowed())
+        {
+            chunks += (run + ChunkSize - 1)/ChunkSize + 1;
+            run = 0;
+        }
+        else
+        {
+            run += chunk->length_;
+        }
+    }
+    packed.pool_.reserve(chunks + (run + ChunkSize - 1)/ChunkSize);
+
+    for (ChunkLink* link = head_.next_; link != &head_; link = link->next_)
+    {
+        Chunk* from = static_cast<Chunk*>(link);
+        if (from->borrowed())
+        {
+            // borrowed characters stay where they are, in a Chunk of
+            // their own
+            Chunk* chunk = packed.insertChunk(&packed.head_);
+            chunk->chars_ = from->chars_;
+            packed.setLength(chunk, from->length_);
+            packed.size_ += from->length_;
+            if (keep.chunk_ == link)
+            {
+                kept = iterator(chunk, keep.charInd_);
+            }
+            continue;
+        }
+
+        // owned characters top up the last Chunk, as in appendChunks
+        const CharT* first = from->chars_;
+        const CharT* last = first + from->length_;
+        size_t remaining = from->length_;
+        while (remaining > 0)
+        {
+            if (packed.chunkCount_ == 0 || isFull(packed.lastChunk()))
+            {
+                packed.insertChunk(&packed.head_);
+            }
+            Chunk* to = packed.lastChunk();
+            size_t offset = first - from->chars_;
+            size_t start = to->length_;
+            size_t copied = packed.fillChunk(to, first, last, remaining,
+                                    std::random_access_iterator_tag());
+            packed.size_ += copied;
+
+            if (keep.chunk_ == link && keep.charInd_ >= offset
+                && keep.charInd_ < offset + copied)
+            {
+                kept = iterator(to, start + keep.charInd_ - offset);
+            }
+        }
+    }
+
+    // the swap also starts the count of edits over
+    packed.owners_ = std::move(owners_);
+    bool atEnd = kept == packed.end();
+    swap(packed);
+
+    return atEnd ? end() : kept;
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::resetHead()
+{
+    head_.prev_ = &head_;
+    head_.next_ = &head_;
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::Chunk*
+    BasicChunkyString<CharT, ChunkSize>::insertChunk(ChunkLink* next)
+{
+    return linkChunk(pool_.allocate(), next);
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::Chunk*
+    BasicChunkyString<CharT, ChunkSize>::linkChunk(Chunk* chunk,
+                                                   ChunkLink* next)
+{
+    // splice the new Chunk in between next and its predecessor
+    chunk->prev_ = next->prev_;
+    chunk->next_ = next;
+    next->prev_->next_ = chunk;
+    next->prev_ = chunk;
+    ++chunkCount_;
+
+    if (head_.indexed_)
+    {
+        indexInsert(chunk);
+    }
+
+    return chunk;
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::ChunkLink*
+    BasicChunkyString<CharT, ChunkSize>::eraseChunk(ChunkLink* chunk)
+{
+    ChunkLink* next = chunk->next_;
+
+    if (head_.indexed_)
+    {
+        indexErase(static_cast<Chunk*>(chunk));
+    }
+
+    chunk->prev_->next_ = next;
+    next->prev_ = chunk->prev_;
+    --chunkCount_;
+    if (chunk != &local_)
+    {
+        pool_.deallocate(static_cast<Chunk*>(chunk));
+    }
+
+    return next;
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::Chunk*
+    BasicChunkyString<CharT, ChunkSize>::lastChunk()
+{
+    return static_cast<Chunk*>(head_.prev_);
+}
+
+template <typename CharT, size_t ChunkSize>
+bool BasicChunkyString<CharT, ChunkSize>::isSmall() const
+{
+    return head_.next_ == &local_;
+}
+
+template <typename CharT, size_t ChunkSize>
+bool BasicChunkyString<CharT, ChunkSize>::makeSmall(size_t count)
+{
+    if (count > SMALL_SIZE)
+    {
+        return false;
+    }
+    if (isSmall())
+    {
+        return true;
+    }
+    if (chunkCount_ > 0 || pool_.available() > 0)
+    {
+        return false;
+    }
+
+    linkChunk(&local_, &head_);
+    return true;
+}
+
+template <typename CharT, size_t ChunkSize>
+CharT* BasicChunkyString<CharT, ChunkSize>::growSmall(size_t ind,
+                                                      size_t count)
+{
+    std::copy_backward(small_ + ind, small_ + size_, small_ + size_ + count);
+    setLength(&local_, local_.length_ + count);
+    size_ += count;
+    return small_ + ind;
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::iterator
+    BasicChunkyString<CharT, ChunkSize>::promote(iterator i)
+{
+    if (!isSmall())
+    {
+        return i;
+    }
+
+    // set the Chunks aside first, so running out of memory leaves the
+    // string as it was
+    size_t remaining = size_;
+    pool_.reserve((remaining + ChunkSize - 1)/ChunkSize);
+    size_t keep = i == end() ? size_ : i.charInd_;
+    eraseChunk(&local_);
+    local_.length_ = 0;
+
+    iterator kept = end();
+    const CharT* first = small_;
+    const CharT* last = small_ + size_;
+    while (remaining > 0)
+    {
+        Chunk* chunk = insertChunk(&head_);
+        size_t start = first - small_;
+        fillChunk(chunk, first, last, remaining,
+                  std::random_access_iterator_tag());
+        if (keep >= start && keep < start + chunk->length_)
+        {
+            kept = iterator(chunk, keep - start);
+        }
+    }
+    return kept;
+}
+
+template <typename CharT, size_t ChunkSize>
+bool BasicChunkyString<CharT, ChunkSize>::isFull(const Chunk* chunk)
+{
+    return backRoom(chunk) == 0;
+}
+
+template <typename CharT, size_t ChunkSize>
+size_t BasicChunkyString<CharT, ChunkSize>::frontRoom(const Chunk* chunk)
+{
+    return chunk->borrowed() ? 0 : chunk->chars_ - chunk->storage_;
+}
+
+template <typename CharT, size_t ChunkSize>
+size_t BasicChunkyString<CharT, ChunkSize>::backRoom(const Chunk* chunk)
+{
+    return chunk->borrowed() ? 0 : ChunkSize - frontRoom(chunk)
+                                   - chunk->length_;
+}
+
+template <typename CharT, size_t ChunkSize>
+size_t BasicChunkyString<CharT, ChunkSize>::roomBefore(
+                                            const Chunk* chunk) const
+{
+    return chunk->prev_ == &head_
+               ? 0 : backRoom(static_cast<const Chunk*>(chunk->prev_));
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::shiftToPrevious(Chunk* chunk,
+                                                          size_t count)
+{
+    Chunk* prevChunk = static_cast<Chunk*>(chunk->prev_);
+    std::copy(chunk->chars_, chunk->chars_ + count,
+              prevChunk->chars_ + prevChunk->length_);
+    setLength(prevChunk, prevChunk->length_ + count);
+    chunk->chars_ += count;
+    setLength(chunk, chunk->length_ - count);
+}
+
+template <typename CharT, size_t ChunkSize>
+bool BasicChunkyString<CharT, ChunkSize>::worthSplitting(size_t count)
+{
+    // both sides of the split keep at least a quarter of a Chunk
+    return count > MAX_SHIFT && count >= ChunkSize/4;
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::Chunk*
+    BasicChunkyString<CharT, ChunkSize>::splitChunk(Chunk* chunk,
+                                                    size_t keep)
+{
+    Chunk* back = insertChunk(chunk->next_);
+    std::copy(chunk->chars_ + keep, chunk->chars_ + chunk->length_,
+              back->chars_);
+    setLength(back, chunk->length_ - keep);
+    setLength(chunk, keep);
+    return back;
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::settle(Chunk* chunk)
+{
+    if (frontRoom(chunk) > 0)
+    {
+        std::copy(chunk->chars_, chunk->chars_ + chunk->length_,
+                  chunk->storage_);
+        chunk->chars_ = chunk->storage_;
+    }
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::iterator
+    BasicChunkyString<CharT, ChunkSize>::own(iterator i)
+{
+    if (i == end() || !i.chunk()->borrowed())
+    {
+        return i;
+    }
+
+    // copy out [from, to), with i near the middle, leaving room to grow
+    Chunk* chunk = i.chunk();
+    size_t length = chunk->length_;
+    size_t window = ChunkSize/2;
+    size_t from = i.charInd_ - std::min(i.charInd_, window/2);
+    size_t to = std::min(length, from + window);
+
+    Chunk* owned = insertChunk(chunk->next_);
+    std::copy(chunk->chars_ + from, chunk->chars_ + to, owned->chars_);
+    setLength(owned, to - from);
+
+    if (to < length)
+    {
+        Chunk* rest = insertChunk(owned->next_);
+        rest->chars_ = chunk->chars_ + to;
+        setLength(rest, length - to);
+    }
+
+    if (from == 0)
+    {
+        eraseChunk(chunk);
+    }
+    else
+    {
+        setLength(chunk, from);
+    }
+
+    return iterator(owned, i.charInd_ - from);
+}
+
+template <typename CharT, size_t ChunkSize>
+template <typename InputIt>
+size_t BasicChunkyString<CharT, ChunkSize>::fillChunk(Chunk* chunk,
+                    InputIt& first, InputIt last, size_t&,
+                    std::input_iterator_tag)
+{
+    size_t length = chunk->length_;
+    size_t room = length + backRoom(chunk);
+    while(first != last && length < room)
+    {
+        chunk->chars_[length] = *first;
+        ++first;
+        ++length;
+    }
+
+    size_t copied = length - chunk->length_;
+    setLength(chunk, length);
+    return copied;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <typename RandomIt>
+size_t BasicChunkyString<CharT, ChunkSize>::fillChunk(Chunk* chunk,
+                    RandomIt& first, RandomIt, size_t& remaining,
+                    std::random_access_iterator_tag)
+{
+    // we know how much is coming, so copy it in one go
+    size_t copied = std::min(remaining, backRoom(chunk));
+    std::copy(first, first + copied, chunk->chars_ + chunk->length_);
+    first += copied;
+    remaining -= copied;
+
+    setLength(chunk, chunk->length_ + copied);
+    return copied;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <typename InputIt>
+size_t BasicChunkyString<CharT, ChunkSize>::rangeLength(InputIt, InputIt,
+                                                std::input_iterator_tag)
+{
+    return 0;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <typename RandomIt>
+size_t BasicChunkyString<CharT, ChunkSize>::rangeLength(RandomIt first,
+                    RandomIt last, std::random_access_iterator_tag)
+{
+    // a ChunkyString iterator without an index walks the Chunks here
+    return size_t(last - first);
+}
+
+template <typename CharT, size_t ChunkSize>
+int BasicChunkyString<CharT, ChunkSize>::compare(
+                                            const BasicChunkyString& rhs) const
+{
+    using traits = std::char_traits<CharT>;
+
+    const ChunkLink* lhsLink = head_.next_;
+    const ChunkLink* rhsLink = rhs.head_.next_;
+    size_t lhsInd = 0;
+    size_t rhsInd = 0;
+
+    for (size_t remaining = std::min(size_, rhs.size_); remaining > 0; )
+    {
+        const Chunk* lhsChunk = static_cast<const Chunk*>(lhsLink);
+        const Chunk* rhsChunk = static_cast<const Chunk*>(rhsLink);
+        const CharT* lhsChars = lhsChunk->chars_ + lhsInd;
+        const CharT* rhsChars = rhsChunk->chars_ + rhsInd;
+        size_t span = std::min({ lhsChunk->length_ - lhsInd,
+                                 rhsChunk->length_ - rhsInd, remaining });
+
+        // traits::compare is memcmp for char, which is vectorized; only
+        // a block known to differ is searched character by character,
+        // so ordering stays the same as lexicographical_compare's
+        if (traits::compare(lhsChars, rhsChars, span) != 0)
+        {
+            std::pair<const CharT*, const CharT*> diff =
+                std::mismatch(lhsChars, lhsChars + span, rhsChars);
+            return *diff.first < *diff.second ? -1 : 1;
+        }
+
+        remaining -= span;
+        lhsInd += span;
+        rhsInd += span;
+        if (lhsInd == lhsChunk->length_)
+        {
+            lhsLink = lhsLink->next_;
+            lhsInd = 0;
+        }
+        if (rhsInd == rhsChunk->length_)
+        {
+            rhsLink = rhsLink->next_;
+            rhsInd = 0;
+        }
+    }
+
+    // one is a prefix of the other
+    return size_ < rhs.size_ ? -1 : size_ > rhs.size_ ? 1 : 0;
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::appendChunks(
+                                            const BasicChunkyString& src)
+{
+    // When src is *this, the Chunks we append to are also being read,
+    // so stop after src's original size rather than at its end.  Reads
+    // always stay ahead of the cells being written.
+    size_t remaining = src.size_;
+    if (remaining > 0 && makeSmall(size_ + remaining))
+    {
+        CharT* to = growSmall(size_, remaining);
+        for (const ChunkLink* link = src.head_.next_; remaining > 0;
+             link = link->next_)
+        {
+            const Chunk* from = static_cast<const Chunk*>(link);
+            size_t count = std::min(from->length_, remaining);
+            to = std::copy(from->chars_, from->chars_ + count, to);
+            remaining -= count;
+        }
+        return;
+    }
+    promote(end());
+
+    for (const ChunkLink* link = src.head_.next_; remaining > 0;
+         link = link->next_)
+    {
+        const Chunk* from = static_cast<const Chunk*>(link);
+        size_t count = std::min(from->length_, remaining);
+        remaining -= count;
+        const CharT* first = from->chars_;
+        const CharT* last = first + count;
+
+        while (count > 0)
+        {
+            if (chunkCount_ == 0 || isFull(lastChunk()))
+            {
+                insertChunk(&head_);
+            }
+            size_ += fillChunk(lastChunk(), first, last, count,
+                               std::random_access_iterator_tag());
+        }
+    }
+}
+
+template <typename CharT, size_t ChunkSize>
+bool BasicChunkyString<CharT, ChunkSize>::joinChunks(Chunk* front,
+                                                     Chunk* back)
+{
+    if (front->borrowed() || back->borrowed()
+        || front->length_ + back->length_ > ChunkSize)
+    {
+        return false;
+    }
+    settle(front);
+
+    std::copy(back->chars_, back->chars_ + back->length_,
+              front->chars_ + front->length_);
+    setLength(front, front->length_ + back->length_);
+    eraseChunk(back);
+    return true;
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::setLength(Chunk* chunk,
+                                                    size_t length)
+{
+    if (head_.indexed_)
+    {
+        // every subtree holding chunk grows (or shrinks, thanks to
+        // unsigned wraparound) by the same amount
+        size_t delta = length - chunk->length_;
+
+        for (IndexNode* node = chunk->node_; !isAnchor(node);
+             node = node->parent_)
+        {
+            node->weight_ += delta;
+        }
+    }
+
+    chunk->length_ = length;
+}
+
+// ---------------------------------------------
+// Implementation of the position index
+// ---------------------------------------------
+//
+template <typename CharT, size_t ChunkSize>
+unsigned BasicChunkyString<CharT, ChunkSize>::nextPriority()
+{
+    // xorshift32; priorities only need to look random to keep the
+    // treap balanced
+    unsigned x = head_.seed_;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    head_.seed_ = x;
+    return x;
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::buildIndex()
+{
+    // Classic linear-time treap construction from sorted input: keep the
+    // right spine of the tree built so far on a stack, and hang each new
+    // node off the spine below the last node with a higher priority.
+    std::vector<IndexNode*> spine;
+
+    // all the nodes come out of a single slab
+    nodes_.reserve(chunkCount_);
+
+    for (ChunkLink* link = head_.next_; link != &head_; link = link->next_)
+    {
+        IndexNode* node = nodes_.allocate();
+        node->link_ = link;
+        node->priority_ = nextPriority();
+        link->node_ = node;
+
+        IndexNode* below = nullptr;
+        while (!spine.empty() && spine.back()->priority_ < node->priority_)
+        {
+            below = spine.back();
+            spine.pop_back();
+        }
+
+        node->left_ = below;
+        if (below != nullptr)
+        {
+            below->parent_ = node;
+        }
+
+        if (spine.empty())
+        {
+            node->parent_ = &head_.anchor_;
+        }
+        else
+        {
+            spine.back()->right_ = node;
+            node->parent_ = spine.back();
+        }
+        spine.push_back(node);
+    }
+
+    head_.root_ = spine.empty() ? nullptr : spine.front();
+    head_.indexed_ = true;
+    updateWeight(head_.root_);
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::indexInsert(Chunk* chunk)
+{
+    IndexNode* node = nodes_.allocate();
+    node->link_ = chunk;
+    node->priority_ = nextPriority();
+    node->weight_ = chunk->length_;
+    chunk->node_ = node;
+
+    // Of two neighbouring Chunks, either the first has no right child or
+    // the second has no left child, so there is always a free slot for
+    // the new Chunk right between them.
+    if (head_.root_ == nullptr)
+    {
+        head_.root_ = node;
+        node->parent_ = &head_.anchor_;
+    }
+    else if (chunk->prev_ != &head_ && chunk->prev_->node_->right_ == nullptr)
+    {
+        chunk->prev_->node_->right_ = node;
+        node->parent_ = chunk->prev_->node_;
+    }
+    else
+    {
+        chunk->next_->node_->left_ = node;
+        node->parent_ = chunk->next_->node_;
+    }
+
+    for (IndexNode* above = node->parent_; !isAnchor(above);
+         above = above->parent_)
+    {
+        above->weight_ += chunk->length_;
+    }
+
+    // restore the heap order on priorities
+    while (!isAnchor(node->parent_)
+           && node->parent_->priority_ < node->priority_)
+    {
+        indexRotateUp(node);
+    }
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::indexErase(Chunk* chunk)
+{
+    IndexNode* node = chunk->node_;
+
+    // rotate node down until it has at most one child...
+    while (node->left_ != nullptr && node->right_ != nullptr)
+    {
+        indexRotateUp(node->left_->priority_ > node->right_->priority_
+                      ? node->left_ : node->right_);
+    }
+
+    // ...then let that child take its place
+    IndexNode* child = node->left_ != nullptr ? node->left_ : node->right_;
+    IndexNode* parent = node->parent_;
+
+    if (child != nullptr)
+    {
+        child->parent_ = parent;
+    }
+
+    if (isAnchor(parent))
+    {
+        head_.root_ = child;
+    }
+    else
+    {
+        (parent->left_ == node ? parent->left_ : parent->right_) = child;
+    }
+
+    for (IndexNode* above = parent; !isAnchor(above);
+         above = above->parent_)
+    {
+        above->weight_ -= chunk->length_;
+    }
+    chunk->node_ = nullptr;
+    nodes_.deallocate(node);
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::indexRotateUp(IndexNode* node)
+{
+    IndexNode* parent = node->parent_;
+    IndexNode* grandparent = parent->parent_;
+
+    if (node == parent->left_)
+    {
+        parent->left_ = node->right_;
+        if (node->right_ != nullptr)
+        {
+            node->right_->parent_ = parent;
+        }
+        node->right_ = parent;
+    }
+    else
+    {
+        parent->right_ = node->left_;
+        if (node->left_ != nullptr)
+        {
+            node->left_->parent_ = parent;
+        }
+        node->left_ = parent;
+    }
+
+    node->parent_ = grandparent;
+    parent->parent_ = node;
+
+    if (isAnchor(grandparent))
+    {
+        head_.root_ = node;
+    }
+    else
+    {
+        (grandparent->left_ == parent ? grandparent->left_
+                                      : grandparent->right_) = node;
+    }
+
+    // node now covers exactly what parent used to
+    node->weight_ = parent->weight_;
+    parent->weight_ = lengthOf(parent) + weightOf(parent->left_)
+                                       + weightOf(parent->right_);
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::Chunk*
+    BasicChunkyString<CharT, ChunkSize>::locate(size_t& pos)
+{
+    // a lone Chunk, as in every small string, needs no index
+    if (chunkCount_ == 1 && !head_.indexed_)
+    {
+        return static_cast<Chunk*>(head_.next_);
+    }
+    if (!head_.indexed_)
+    {
+        buildIndex();
+    }
+
+    return seek(head_.root_, pos);
+}
+
+template <typename CharT, size_t ChunkSize>
+const typename BasicChunkyString<CharT, ChunkSize>::Chunk*
+    BasicChunkyString<CharT, ChunkSize>::locate(size_t& pos) const
+{
+    if (head_.indexed_)
+    {
+        return seek(head_.root_, pos);
+    }
+
+    const ChunkLink* link;
+    if (pos < size_ / 2)
+    {
+        link = head_.next_;
+        while (pos >= static_cast<const Chunk*>(link)->length_)
+        {
+            pos -= static_cast<const Chunk*>(link)->length_;
+            link = link->next_;
+        }
+    }
+    else
+    {
+        // walk back, counting the characters from pos to the end
+        size_t fromEnd = size_ - pos;
+        link = head_.prev_;
+        while (fromEnd > static_cast<const Chunk*>(link)->length_)
+        {
+            fromEnd -= static_cast<const Chunk*>(link)->length_;
+            link = link->prev_;
+        }
+        pos = static_cast<const Chunk*>(link)->length_ - fromEnd;
+    }
+    return static_cast<const Chunk*>(link);
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::Chunk*
+    BasicChunkyString<CharT, ChunkSize>::seek(const IndexNode* root,
+                                              size_t& pos)
+{
+    const IndexNode* node = root;
+    for (;;)
+    {
+        size_t leftWeight = weightOf(node->left_);
+
+        if (pos < leftWeight)
+        {
+            node = node->left_;
+            continue;
+        }
+
+        pos -= leftWeight;
+        if (pos < lengthOf(node))
+        {
+            return static_cast<Chunk*>(node->link_);
+        }
+
+        pos -= lengthOf(node);
+        node = node->right_;
+    }
+}
+
+template <typename CharT, size_t ChunkSize>
+size_t BasicChunkyString<CharT, ChunkSize>::weightOf(const IndexNode* node)
+{
+    return node == nullptr ? 0 : node->weight_;
+}
+
+template <typename CharT, size_t ChunkSize>
+void BasicChunkyString<CharT, ChunkSize>::updateWeight(IndexNode* node)
+{
+    // recursion depth is the height of the treap, logarithmic in practice
+    if (node != nullptr)
+    {
+        updateWeight(node->left_);
+        updateWeight(node->right_);
+        node->weight_ = lengthOf(node) + weightOf(node->left_)
+                                       + weightOf(node->right_);
+    }
+}
+
+template <typename CharT, size_t ChunkSize>
+size_t BasicChunkyString<CharT, ChunkSize>::lengthOf(const IndexNode* node)
+{
+    return static_cast<const Chunk*>(node->link_)->length_;
+}
+
+template <typename CharT, size_t ChunkSize>
+bool BasicChunkyString<CharT, ChunkSize>::isAnchor(const IndexNode* node)
+{
+    return node->parent_ == node;
+}
+
+template <typename CharT, size_t ChunkSize>
+bool BasicChunkyString<CharT, ChunkSize>::isHead(const ChunkLink* link)
+{
+    // only the head's node_ is an anchor, and Chunks without a node_ are
+    // told apart without following it
+    return link->node_ != nullptr && isAnchor(link->node_);
+}
+
+template <typename CharT, size_t ChunkSize>
+bool BasicChunkyString<CharT, ChunkSize>::isIndexed(const ChunkLink* link)
+{
+    if (isHead(link))
+    {
+        return static_cast<const ChunkHead*>(link)->indexed_;
+    }
+    return link->node_ != nullptr;
+}
+
+template <typename CharT, size_t ChunkSize>
+size_t BasicChunkyString<CharT, ChunkSize>::positionOf(const ChunkLink* link,
+                                                      size_t charInd)
+{
+    if (isHead(link))
+    {
+        return weightOf(static_cast<const ChunkHead*>(link)->root_);
+    }
+
+    // everything to the left of us in the tree comes before us
+    const IndexNode* node = link->node_;
+    size_t pos = charInd + weightOf(node->left_);
+
+    while (!isAnchor(node->parent_))
+    {
+        const IndexNode* parent = node->parent_;
+        if (node == parent->right_)
+        {
+            pos += weightOf(parent->left_) + lengthOf(parent);
+        }
+        node = parent;
+    }
+
+    return pos;
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::ChunkHead*
+    BasicChunkyString<CharT, ChunkSize>::headOf(const ChunkLink* link)
+{
+    // the anchor is its own parent, so this also works for the head itself
+    const IndexNode* node = link->node_;
+    while (!isAnchor(node))
+    {
+        node = node->parent_;
+    }
+    return static_cast<ChunkHead*>(node->link_);
+}
+
+// ---------------------------------------------
+// Implementation of BasicChunkyString::Chunk
+// ---------------------------------------------
+//
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>::Chunk::Chunk()
+    : ChunkLink{nullptr, nullptr, nullptr}, length_{0}, chars_{storage_}
+{
+    // storage_ is left uninitialized, only the first length_ cells are used
+}
+
+template <typename CharT, size_t ChunkSize>
+bool BasicChunkyString<CharT, ChunkSize>::Chunk::borrowed() const
+{
+    // owned characters can start part way into storage_, never past it
+    std::less<const CharT*> below;
+    return below(chars_, storage_) || !below(chars_, storage_ + ChunkSize);
+}
+
+// ---------------------------------------------
+// Implementation of BasicChunkyString::ChunkHead
+// ---------------------------------------------
+//
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>::ChunkHead::ChunkHead()
+    : ChunkLink{this, this, &anchor_},
+      anchor_{&anchor_, nullptr, nullptr, this, 0, 0},
+      root_{nullptr}, indexed_{false}, seed_{2463534242u}
+{
+    // An empty, unindexed list
+}
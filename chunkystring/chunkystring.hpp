@@ -3,7 +3,8 @@
  *
  * \authors CS 70 given code, with additions by ... your names here ...
  *
- * \brief Declares the ChunkyString class.
+ * \brief Declares the BasicChunkyString class template and the
+ *        ChunkyString alias.
  */
 
 #ifndef CHUNKYSTRING_HPP_INCLUDED
@@ -11,32 +12,65 @@
 
 #include <cstddef>
 #include <string>
-#include <list>
 #include <iterator>
 #include <iostream>
 #include <type_traits>
+#include <memory>
+#include <vector>
+
+#include "chunk-pool.hpp"
 
 /**
- * \class ChunkyString
+ * \class BasicChunkyString
  * \brief Efficiently represents strings where insert and erase are
  *    constant-time operations.
  *
  * \details This class is comparable to a linked-list of characters,
  *   but more space efficient.
  *
+ *   The character type and the number of characters stored in each
+ *   chunk are fixed at compile time, so every operation is specialized
+ *   for the chosen layout.  Small chunks keep single-character edits
+ *   cheap; large (cache-line sized) chunks cut the per-chunk overhead
+ *   for bulk text.
+ *
+ *   A chunk's characters can sit anywhere in its storage, so an edit
+ *   only moves the shorter side of a chunk.  With the openGaps policy,
+ *   a run of edits working along the string also keeps the free cells
+ *   of two neighbouring chunks where the edits are, like a gap buffer.
+ *
+ *   Strings of up to SMALL_SIZE characters (64 bytes) keep them inside
+ *   the string object and allocate nothing; the first edit that takes a
+ *   string past that moves its characters out into chunks.
+ *
+ * \tparam CharT      character type; must be trivially copyable
+ * \tparam ChunkSize  number of characters each chunk can hold
+ *
  * \remarks
  *   reverse_iterator and const_reverse_iterator aren't
  *   supported. Other than that, we use the STL container typedefs
- *   such that STL functions are compatible with ChunkyString.
+ *   such that STL functions are compatible with BasicChunkyString.
  */
-class ChunkyString {
-    // Forward declaration of private class.
+template <typename CharT, size_t ChunkSize>
+class BasicChunkyString {
+    static_assert(ChunkSize >= 2, "a chunk must be able to hold two "
+                                  "characters so that it can be split");
+    static_assert(std::is_trivial<CharT>::value,
+                  "chunks store characters in raw arrays");
+
+    // Forward declaration of private classes.
     template <bool const_iter>
     class Iterator;
+    template <typename SegCharT>
+    class Segment;
+    template <bool const_seg>
+    class SegmentIterator;
+    template <bool const_seg>
+    class SegmentRange;
 
 public:
     // Standard STL container type definitions
-    using value_type      = char;
+    using value_type      = CharT;
     using size_type       = size_t;
     using difference_type = ptrdiff_t;
     using reference       = value_type&;
@@ -45,6 +79,13 @@ public:
     using iterator = Iterator<false>;
     using const_iterator = Iterator<true>;
 
+    using segment = Segment<CharT>;
+    using const_segment = Segment<const CharT>;
+    using segment_iterator = SegmentIterator<false>;
+    using const_segment_iterator = SegmentIterator<true>;
+    using segment_range = SegmentRange<false>;
+    using const_segment_range = SegmentRange<true>;
+
     // reverse_iterator and const_reverse_iterator aren't supported
 
     /**
@@ -52,15 +93,34 @@ public:
      *
      * \note constant time
      */
-    ChunkyString();
+    BasicChunkyString();
 
-    ~ChunkyString() = default;
+    ~BasicChunkyString() = default;
 
-    void swap(ChunkyString& rhs);
+    /**
+     * \brief Exchange contents with rhs
+     *
+     * \note constant time, never throws
+     *
+     * \warning iterators into a string of at most SMALL_SIZE characters
+     *   are invalidated, since its characters stay in the string object
+     */
+    void swap(BasicChunkyString& rhs) noexcept;
     /**
      * \brief Copy constructor
+     *
+     * \note linear time, one block copy per Chunk; the copy's Chunks are
+     *       packed full regardless of how full orig's are
+     */
+    BasicChunkyString(const BasicChunkyString& orig);
+
+    /**
+     * \brief Move constructor; orig is left empty
+     *
+     * \note constant time, the Chunks stay where they are; a string of at
+     *       most SMALL_SIZE characters is copied
      */
-    ChunkyString(const ChunkyString& orig);
+    BasicChunkyString(BasicChunkyString&& orig) noexcept;
 
     /// Return an iterator to the first character in the ChunkyString.
     iterator begin();
@@ -72,29 +132,114 @@ public:
     /// Return a const iterator to "one past the end"
     const_iterator end() const;
 
+    /**
+     * \brief The string's characters as a sequence of contiguous spans.
+     * \details
+     *   Each segment is the (pointer, length) of the characters in one
+     *   Chunk, so routines such as memchr or ostream::write can run over
+     *   a whole Chunk at once.  Concatenated, the segments are the
+     *   string, and none of them is empty.  Characters can be changed
+     *   through the non-const segments, but not added or removed.
+     *
+     * \note constant time; iterating takes one step per Chunk
+     *
+     * \warning invalidated, like iterators, by insert and erase
+     */
+    segment_range segments();
+    const_segment_range segments() const;  ///< \copydoc segments()
+
     /**
      * \brief Inserts a character at the end of the ChunkyString.
      *
      * \param c     Character to insert
-     * 
+     *
      * \note constant time
      */
-    void push_back(char c);
+    void push_back(CharT c);
 
-    // Standard string functions: size, append, equality, less than    
+    // Standard string functions: size, append, equality, less than
     size_t size() const;    ///< String size \note constant time
-    static const size_t CHUNKSIZE = 12;
-    
-    ChunkyString& operator+=(const ChunkyString& rhs); ///< String concatenation
+
+    /**
+     * \brief Number of characters the string can grow to by push_back
+     *        before it needs to allocate.
+     *
+     * \details Counts the free cells of the last Chunk and the Chunks
+     *   set aside by reserve(), or SMALL_SIZE for a string that keeps its
+     *   characters in the string object.
+     *
+     * \note constant time
+     */
+    size_t capacity() const;
+
+    /**
+     * \brief Set aside enough Chunks, in one contiguous slab, for the
+     *        string to grow to count characters without allocating.
+     *
+     * \details The Chunks are there for any edit that needs one, so
+     *   inserts that split a Chunk and appends also draw on them; copies
+     *   don't inherit them, and shrink_to_fit() releases them.
+     *
+     * \note linear in the number of Chunks set aside
+     */
+    void reserve(size_t count);
+    static const size_t CHUNKSIZE = ChunkSize;
+
+    /// Most characters a string keeps inside the string object, in 64
+    /// bytes, before it moves them out into Chunks
+    static const size_t SMALL_SIZE = 64/sizeof(CharT) > 0
+                                         ? 64/sizeof(CharT) : 1;
+
+    /// String concatenation \note one block copy per Chunk of rhs
+    BasicChunkyString& operator+=(const BasicChunkyString& rhs);
+    /// String concatenation that takes rhs's Chunks, leaving it empty
+    /// \note constant time, see splice()
+    BasicChunkyString& operator+=(BasicChunkyString&& rhs);
 
     /// Assignment operator
-    ChunkyString& operator=(const ChunkyString& rhs);
+    BasicChunkyString& operator=(const BasicChunkyString& rhs);
+    /// Move assignment; rhs is left empty \note constant time
+    BasicChunkyString& operator=(BasicChunkyString&& rhs) noexcept;
 
-    bool operator==(const ChunkyString& rhs) const;    ///< String equality
-    bool operator!=(const ChunkyString& rhs) const;    ///< String inequality
+    /// String equality \note compares a contiguous block at a time
+    bool operator==(const BasicChunkyString& rhs) const;
+    /// String inequality
+    bool operator!=(const BasicChunkyString& rhs) const;
 
-    /// Lexicographical string comparison
-    bool operator<(const ChunkyString& rhs) const; 
+    /// Lexicographical string comparison \note compares a block at a time
+    bool operator<(const BasicChunkyString& rhs) const;
+
+    /**
+     * \brief The character at position pos
+     *
+     * \throws std::out_of_range  if pos >= size()
+     *
+     * \note logarithmic time, see iterator_at()
+     */
+    reference at(size_t pos);
+    const_reference at(size_t pos) const;   ///< \copydoc at(size_t)
+
+    /**
+     * \brief An iterator to the character at position pos
+     * \details
+     *   The first positional query builds an index over the string's
+     *   Chunks, which takes time linear in the number of Chunks.  From
+     *   then on the string keeps the index up to date: positional
+     *   queries and iterator differences take logarithmic time, and
+     *   every insert and erase pays a logarithmic update.  The index
+     *   takes about 48 bytes per Chunk, held apart from the Chunks, so
+     *   strings that never ask for it don't pay for it.
+     *
+     *   Queries through a const string use the index if it's there but
+     *   never build it, walking the Chunks instead, so several threads
+     *   can read a string that none of them changes.
+     *
+     * \param pos   position of the character, or size() for end()
+     *
+     * \throws std::out_of_range  if pos > size()
+     */
+    iterator iterator_at(size_t pos);
+    const_iterator iterator_at(size_t pos) const; ///< \copydoc iterator_at
 
     /**
      * \brief Insert a character before the character at i.
@@ -111,7 +256,34 @@ public:
      *
      * \warning invalidates all iterators except the returned iterator
      */
-    iterator insert(iterator i, char c);
+    iterator insert(iterator i, CharT c);
+
+    /**
+     * \brief Insert the characters of [first, last) before i.
+     * \details
+     *   Fills the Chunk at i, links in as many full Chunks as the input
+     *   needs, and puts the characters that followed i back at the end,
+     *   evening out the last two Chunks if they don't fit in one.  Only
+     *   the Chunks at either end of the new text are ever partly full.
+     *
+     * \param i      iterator to specify insertion point
+     * \param first  start of the characters to insert; must not point
+     *               into this string
+     * \param last   end of the characters to insert
+     *
+     * \returns an iterator pointing to the first inserted character, or
+     *   i if the range is empty.
+     *
+     * \note linear in the number of characters inserted
+     *
+     * \warning invalidates all iterators except the returned iterator
+     */
+    template <typename InputIt>
+    iterator insert(iterator i, InputIt first, InputIt last);
+
+    /// Insert count characters starting at chars before i
+    /// \copydetails insert(iterator, InputIt, InputIt)
+    iterator insert(iterator i, const CharT* chars, size_t count);
 
     /**
      * \brief Erase a character at i
@@ -130,44 +302,247 @@ public:
      */
     iterator erase(iterator i);
 
+    /**
+     * \brief Erase the characters in [first, last)
+     * \details
+     *   Whole Chunks in the range are unlinked without looking at their
+     *   characters; only the two Chunks at the ends of the range are
+     *   trimmed, then merged or evened out so neither is left almost
+     *   empty.
+     *
+     * \returns an iterator pointing to the character that followed the
+     *   erased range.
+     *
+     * \note linear in the number of Chunks in the range
+     *
+     * \warning invalidates all iterators except the returned iterator
+     */
+    iterator erase(iterator first, iterator last);
+
+    /**
+     * \brief Move all of other's characters in before pos, without
+     *        copying them.
+     * \details
+     *   other's Chunks are linked into this string's list as they are,
+     *   and this string takes over the memory they live in and anything
+     *   other borrows, so other is left empty.  Only the Chunks at the
+     *   two seams are touched: the Chunk at pos is split in two if pos is
+     *   inside it, and neighbours across a seam are merged if they fit
+     *   in one Chunk.  The characters of an other of at most SMALL_SIZE
+     *   characters live inside other, so they are copied instead.
+     *
+     * \param pos    iterator to specify insertion point
+     * \param other  the string to take characters from; must not be this
+     *               string
+     *
+     * \returns an iterator pointing to the first spliced character, or
+     *   pos if other is empty.
+     *
+     * \note constant time, plus time linear in the number of Chunks of
+     *       other if either string has a position index (see iterator_at)
+     *
+     * \warning invalidates all iterators into both strings except the
+     *   returned iterator
+     */
+    iterator splice(iterator pos, BasicChunkyString& other);
+
+    /**
+     * \brief Append count characters that live outside the string
+     *        without copying them.
+     * \details
+     *   The characters become a single borrowed Chunk of any length.
+     *   Reading, and writing through iterators or segments, goes straight
+     *   to the borrowed memory; insert and erase copy out only the part
+     *   of a borrowed run they touch, so an edited string costs memory in
+     *   proportion to the edits rather than to its size.  Copies of the
+     *   string own all their characters.
+     *
+     *   Typically the characters are a MAP_PRIVATE file mapping (see
+     *   mapFile in chunkystring-io.hpp), so that writes are copy-on-write
+     *   and never reach the file.
+     *
+     * \param chars  first character; must stay valid and writable while
+     *               owner lives
+     * \param count  number of characters
+     * \param owner  kept until the string is destroyed or assigned to
+     *
+     * \note constant time
+     */
+    void borrow(CharT* chars, size_t count, std::shared_ptr<void> owner);
+
     /**
      * \brief Average capacity of each chunk, as a percentage
-     * \details 
+     * \details
      *   This function computes the fraction of the ChunkyString's character
-     *   cells that are in use. It is defined as 
+     *   cells that are in use. It is defined as
      *
      *   \f[\frac{\mbox{number of characters in the string}}
-     *           {\mbox{number of chunks}\times\mbox{CHUNKSIZE}}  \f] 
-     *   
-     *   For reasonably sized strings (i.e., those with more than one or two 
-     *   characters), utilization should never fall to near one character per 
+     *           {\mbox{number of chunks}\times\mbox{CHUNKSIZE}}  \f]
+     *
+     *   For reasonably sized strings (i.e., those with more than one or two
+     *   characters), utilization should never fall to near one character per
      *   chunk; otherwise the data structure would be wasting too much space.
      *
      *   The utilization for an empty string is undefined (i.e., any value is
-     *   acceptable).
+     *   acceptable).  Borrowed characters (see borrow()) are counted, but
+     *   their Chunks can hold any number of them, so a string that
+     *   borrows can report a utilization above 1.  Characters kept in the
+     *   string object (see SMALL_SIZE) count as if packed into full
+     *   Chunks.
+     *
+     * \note constant time; the Chunks are counted as they come and go
      */
     double utilization() const;
 
     /**
-    * \brief A helper function to increase utilization past 1/4.
-    * \details 
-    *   This function iterates through the Chunks of the ChunkyString and
-    *   combines Chunks with substandard utilization until utilzation > 1/4.
+     * \struct CompactionPolicy
+     *
+     * \brief How hard the string works to keep its Chunks full.
+     */
+    struct CompactionPolicy {
+        /// Chunks left with fewer characters than this by an erase are
+        /// merged with or topped up from a neighbour, as in a B-tree.
+        /// At most CHUNKSIZE/2; 0 only ever drops empty Chunks.
+        size_t minFill;
+
+        /// Once utilization() falls below this, the next insert or erase
+        /// repacks the whole string (see shrink_to_fit), provided there
+        /// have been at least as many edits as there are Chunks since the
+        /// last repack, which keeps the cost per edit constant.  0, the
+        /// default, never repacks; otherwise inserts and erases may
+        /// invalidate every iterator but the one they return.
+        double repackBelow;
+
+        /// Whether edits keep free cells where they happen, like a gap
+        /// buffer, by moving characters into the Chunk in front or
+        /// splitting off a new one.  Runs of edits working along the
+        /// string then cost constant time per character even with large
+        /// Chunks, but inserts only keep Chunks minFill full, rather than
+        /// half full.  Off by default.
+        bool openGaps;
+
+        CompactionPolicy(size_t minFill = ChunkSize/4,
+                         double repackBelow = 0, bool openGaps = false);
+    };
+
+    /// The current compaction policy \note constant time
+    CompactionPolicy compaction_policy() const;
+
+    /**
+     * \brief Change the compaction policy for future edits.
+     *
+     * \details The policy is copied, moved and swapped along with the
+     *   string's characters.
+     *
+     * \throws std::invalid_argument  if policy.minFill > CHUNKSIZE/2 or
+     *   policy.repackBelow isn't between 0 and 1
+     */
+    void set_compaction_policy(const CompactionPolicy& policy);
+
+    /**
+     * \brief Repack the string's characters into as few Chunks as
+     *        possible, and release the memory the rest took up.
+     * \details
+     *   Owned characters are copied into full Chunks in a single pass
+     *   over a fresh pool; borrowed Chunks are kept as they are.
+     *
+     * \note linear time
+     *
+     * \warning invalidates all iterators
+     */
+    void shrink_to_fit();
+
+    /**
+    * \brief A helper function to keep Chunks at least minFill full.
+    * \details
+    *   Merges the Chunk i points into with a neighbouring Chunk when
+    *   the characters of both fit in a single Chunk, and otherwise
+    *   borrows characters from the neighbour so both end up with about
+    *   half of the two's characters, at least CHUNKSIZE/2 each.
+    *
+    * \param i     iterator into the Chunk that lost a character; its
+    *              character index may be one past the Chunk's last
+    *              character
+    *
+    * \returns an iterator to the same character as i
     */
     iterator reflow(iterator i);
 
     /**
     * \brief A helper function to shift elements in an array and insert a char.
-    * \details 
-    *   This function iterates through the Chunks of the ChunkyString and
-    *   combines Chunks with substandard utilization until utilzation > 1/4.
+    * \details
+    *   Shifts the characters at and after i one cell to the right and
+    *   stores c in the gap.  The Chunk i points into must not be full.
     * \param i     iterator pointing to a character
-    *
-    * \returns an iterator pointing the same spot of parameter
+    * \param c     character to insert
     */
-    void helperInsert(iterator& i, char c);
+    void helperInsert(iterator& i, CharT c);
 
 private:
+    /// Most characters an edit shifts along within a Chunk; more than
+    /// this (and a quarter of a Chunk) are split off into a Chunk of
+    /// their own instead, opening a gap for the edits that follow
+    static const size_t MAX_SHIFT = 32;
+
+    /**
+     * \struct ChunkLink
+     *
+     * \brief Links of the intrusive, circular, doubly-linked Chunk list.
+     *        The list's sentinel is a bare ChunkLink, so end() costs no
+     *        character storage.
+     */
+    struct IndexNode;
+
+    struct ChunkLink {
+       ChunkLink* prev_;
+       ChunkLink* next_;
+       IndexNode* node_;            // Node in the index; see ChunkHead
+    };
+
+    /**
+     * \struct IndexNode
+     *
+     * \brief A node of the position index, which is a treap over the
+     *        Chunks in list order.
+     *
+     * \details Nodes live in a pool of their own, apart from the Chunks,
+     *   so that strings that never seek by position don't pay for them.
+     */
+    struct IndexNode {
+       IndexNode* parent_;
+       IndexNode* left_;
+       IndexNode* right_;
+       ChunkLink* link_;            // The Chunk this node stands for
+       size_t weight_;              // Characters in this subtree
+       unsigned priority_;          // Treap priority, larger is nearer the root
+    };
+
+    /**
+     * \struct ChunkHead
+     *
+     * \brief The list's sentinel, which also anchors the position index.
+     *
+     * \details The head's node_ is always its anchor_, which is the
+     *   parent_ of the index's root and the only node that is its own
+     *   parent_; that lets iterators tell the head apart and find their
+     *   way to it.  Chunks of a string that isn't indexed have a null
+     *   node_.
+     */
+    struct ChunkHead : ChunkLink {
+       IndexNode anchor_;           // Stands for the head in the index
+       IndexNode* root_;            // Root of the index, if there is one
+       bool indexed_;               // Whether the index is maintained
+       unsigned seed_;              // State for drawing treap priorities
+
+       ChunkHead();
+
+       // The anchor_ has to stay where it is
+       ChunkHead(const ChunkHead&) = delete;
+       ChunkHead& operator=(const ChunkHead&) = delete;
+    };
+
+    struct Chunk;
+
     /***
      * \struct Chunk
      *
@@ -175,16 +550,255 @@ private:
      *        The class is private so only ChunkyString knows about it.
      *
      */
-    struct Chunk {
+    struct Chunk : ChunkLink {
 
        size_t length_;
-       char chars_[CHUNKSIZE];
+       CharT* chars_;               // Into storage_, small_ or a loan
+       CharT storage_[ChunkSize];
+
+       Chunk();
 
-       Chunk(size_t length_, size_t CHUNKSIZE);
+       /// Whether chars_ points outside storage_; see borrow()
+       bool borrowed() const;
     };
 
-    std::list<Chunk> chunks_; 
-    size_t size_; // Current size of ChunkyString
+    ChunkHead head_;          // Sentinel; next_ is the first Chunk
+    Chunk local_;             // The only Chunk of a small string; its
+                              // chars_ are always small_
+    CharT small_[SMALL_SIZE]; // Characters of a small string
+    ChunkPool<Chunk> pool_;   // Where every Chunk of this string lives
+    ChunkPool<IndexNode> nodes_;  // Index nodes, once there is one
+    size_t size_;             // Current size of ChunkyString
+    size_t chunkCount_;       // Number of Chunks in the list
+    CompactionPolicy policy_; // When to merge and repack Chunks
+    size_t edits_;            // Inserts and erases since the last repack
+    std::vector<std::shared_ptr<void>> owners_;  // Keep borrowed chars alive
+
+    /// Point head_ at itself, making the list empty.
+    void resetHead();
+
+    /**
+     * \brief Allocate an empty Chunk from the pool and link it in.
+     *
+     * \param next  the Chunk (or head_) the new Chunk goes in front of
+     *
+     * \returns the new Chunk
+     */
+    Chunk* insertChunk(ChunkLink* next);
+
+    /// Link chunk in front of next, as insertChunk() does, and return it
+    Chunk* linkChunk(Chunk* chunk, ChunkLink* next);
+
+    /**
+     * \brief Unlink a Chunk and return it to the pool, unless it is
+     *        local_.
+     *
+     * \returns the link that followed the erased Chunk
+     */
+    ChunkLink* eraseChunk(ChunkLink* chunk);
+
+    // ----- Small strings -----
+
+    /// Whether the characters are in small_, local_ being the only Chunk
+    bool isSmall() const;
+
+    /**
+     * \brief Whether the string can hold count characters in small_, and
+     *        if so, link in local_ if it isn't already.
+     *
+     * \details Only an empty string whose pool has no Chunks to hand out
+     *   starts using small_; one with Chunks to spare uses those.
+     */
+    bool makeSmall(size_t count);
+
+    /// Open a gap of count cells at ind in small_, which must have room,
+    /// and return a pointer to it
+    CharT* growSmall(size_t ind, size_t count);
+
+    /**
+     * \brief Move the characters of a small string out into Chunks.
+     *
+     * \returns an iterator to the same character as i
+     */
+    iterator promote(iterator i);
+
+    /// The last Chunk; the string must not be empty.
+    Chunk* lastChunk();
+
+    /// Whether chunk has no free cells at its end; borrowed Chunks never
+    /// do.
+    static bool isFull(const Chunk* chunk);
+
+    /// Free cells in front of a Chunk's characters; 0 if it is borrowed
+    static size_t frontRoom(const Chunk* chunk);
+
+    /// Free cells after a Chunk's characters; 0 if it is borrowed
+    static size_t backRoom(const Chunk* chunk);
+
+    /// Free cells at the end of the Chunk before chunk, if there is one
+    size_t roomBefore(const Chunk* chunk) const;
+
+    /**
+     * \brief Move the first count characters of chunk onto the end of
+     *        the Chunk before it, which must have room for them.
+     *
+     * \details Afterwards the free cells of the two Chunks meet where the
+     *   moved characters end, which is what lets a run of edits moving
+     *   through the string act on a gap buffer.
+     */
+    void shiftToPrevious(Chunk* chunk, size_t count);
+
+    /// Whether moving count characters of a Chunk costs enough that they
+    /// should be split off instead; see MAX_SHIFT
+    static bool worthSplitting(size_t count);
+
+    /// Move the characters of chunk from keep on into a new Chunk placed
+    /// after it, and return the new Chunk
+    Chunk* splitChunk(Chunk* chunk, size_t keep);
+
+    /// Move an owned Chunk's characters to the start of its storage, so
+    /// all of its free cells are at the end.
+    static void settle(Chunk* chunk);
+
+    /**
+     * \brief Make sure i points into a Chunk the string owns.
+     *
+     * \details Copies a window of about half a Chunk around i out of a
+     *   borrowed Chunk into a new owned one, leaving the rest of the
+     *   borrowed run on either side where it is.
+     *
+     * \returns an iterator to the same character as i
+     */
+    iterator own(iterator i);
+
+    /**
+     * \brief Copy characters from [first, last) into the free cells at
+     *        the end of chunk, as many as fit.
+     *
+     * \param remaining  for random-access ranges, the number of characters
+     *   left in [first, last), counted down as they are copied, so that
+     *   the range is only measured once; unused for other ranges
+     *
+     * \returns the number of characters copied
+     */
+    template <typename InputIt>
+    size_t fillChunk(Chunk* chunk, InputIt& first, InputIt last,
+                     size_t& remaining, std::input_iterator_tag);
+    template <typename RandomIt>
+    size_t fillChunk(Chunk* chunk, RandomIt& first, RandomIt last,
+                     size_t& remaining, std::random_access_iterator_tag);
+
+    /// The number of characters in [first, last) for random-access
+    /// ranges, and 0 for others, which can't be measured without a pass
+    template <typename InputIt>
+    static size_t rangeLength(InputIt first, InputIt last,
+                              std::input_iterator_tag);
+    template <typename RandomIt>
+    static size_t rangeLength(RandomIt first, RandomIt last,
+                              std::random_access_iterator_tag);
+
+    /**
+     * \brief Three-way lexicographical comparison with rhs.
+     *
+     * \details Walks both Chunk lists together, comparing the longest
+     *   runs that are contiguous in both strings as blocks.
+     *
+     * \returns a negative number, zero, or a positive number as this
+     *          string is less than, equal to, or greater than rhs
+     */
+    int compare(const BasicChunkyString& rhs) const;
+
+    /**
+     * \brief Copy the characters of src onto the end of this string,
+     *        packing them into full Chunks.
+     *
+     * \details src may be this string, its original characters are
+     *   copied exactly once.
+     */
+    void appendChunks(const BasicChunkyString& src);
+
+    /**
+     * \brief Move back's characters onto the end of front, its
+     *        predecessor, and erase back, if both are owned and the
+     *        characters fit.
+     *
+     * \returns whether back was merged into front
+     */
+    bool joinChunks(Chunk* front, Chunk* back);
+
+    /**
+     * \brief Count an edit, and repack the string if the compaction
+     *        policy says it is time.
+     *
+     * \returns an iterator to the same character as i
+     */
+    iterator compact(iterator i);
+
+    /**
+     * \brief Rebuild the string in a fresh pool with its owned
+     *        characters packed into full Chunks.
+     *
+     * \returns an iterator to the same character as keep
+     */
+    iterator repack(iterator keep);
+
+    /// Set a Chunk's length, keeping the index up to date.
+    void setLength(Chunk* chunk, size_t length);
+
+    // ----- Position index -----
+
+    /// Draw a fresh treap priority.
+    unsigned nextPriority();
+
+    /// Build the index over the current Chunks, in linear time.
+    void buildIndex();
+
+    /// Add a Chunk that was just linked into the list to the index.
+    void indexInsert(Chunk* chunk);
+
+    /// Take a Chunk that is about to be unlinked out of the index.
+    void indexErase(Chunk* chunk);
+
+    /// Rotate node above its parent, keeping the weights right.
+    void indexRotateUp(IndexNode* node);
+
+    /**
+     * \brief Find the Chunk holding the character at pos.
+     *
+     * \param pos   on entry a position within the string, on return the
+     *              position within the returned Chunk
+     *
+     * \note Builds the index if there isn't one yet, and there is more
+     *       than one Chunk.  The const version never does, so concurrent
+     *       readers don't race on it; without an index it walks the list
+     *       from the nearer end.
+     */
+    Chunk* locate(size_t& pos);
+    const Chunk* locate(size_t& pos) const; ///< \copydoc locate
+
+    static size_t weightOf(const IndexNode* node);
+    static void updateWeight(IndexNode* node);
+
+    /// Characters in the Chunk a node stands for
+    static size_t lengthOf(const IndexNode* node);
+
+    /// Whether node is a head's anchor_ rather than a Chunk's node
+    static bool isAnchor(const IndexNode* node);
+
+    /// Whether the link is the head of its list.
+    static bool isHead(const ChunkLink* link);
+
+    /// Whether the string the link belongs to maintains an index.
+    static bool isIndexed(const ChunkLink* link);
+
+    /// Position of charInd within link, for a link of an indexed string.
+    static size_t positionOf(const ChunkLink* link, size_t charInd);
+
+    /// The head of the indexed string that link belongs to.
+    static ChunkHead* headOf(const ChunkLink* link);
+
+    /// Like locate(), but starting from a root of the index.
+    static Chunk* seek(const IndexNode* root, size_t& pos);
 
     /**
      * \class Iterator
@@ -196,9 +810,11 @@ private:
      *          The five typedefs and the member functions are such that
      *          the iterator works properly with STL functions (e.g., copy).
      *
-     *          Since this is a bidirectional_iterator, `operator--`
-     *          is provided and meaningful for all iterators except
-     *          ChunkyString::begin.
+     *          This is a random_access_iterator.  Moving by n characters
+     *          skips whole Chunks, so it costs O(n / CHUNKSIZE); on an
+     *          indexed string (see iterator_at) long jumps, differences
+     *          and comparisons go through the index instead and take
+     *          logarithmic time.
      *
      *  \remarks The design of the templated iterator was inspired by these
      *           two sources:
@@ -208,54 +824,223 @@ private:
     template <bool const_iter>
     class Iterator {
     public:
-        
+
         ///< Default constructor
         Iterator();
 
         ///< Convert a non-const iterator to a const-iterator, if necessary
-        Iterator(const Iterator<false>& i);  
+        Iterator(const Iterator<false>& i);
+
+        Iterator& operator=(const Iterator& rhs) = default;
 
         // Make Iterator STL-friendly with these typedefs:
-        using value_type = char;
-        using reference = typename std::conditional<const_iter, 
-                                                    const value_type&, 
+        using value_type = CharT;
+        using reference = typename std::conditional<const_iter,
+                                                    const value_type&,
                                                     value_type&>::type;
-        using pointer = typename std::conditional<const_iter, 
-                                                  const value_type*, 
+        using pointer = typename std::conditional<const_iter,
+                                                  const value_type*,
                                                   value_type*>::type;
-        using list_iterator_type = typename std::conditional<const_iter, 
-                                    std::list<Chunk>::const_iterator, 
-                                    std::list<Chunk>::iterator>::type;
+        using link_pointer = typename std::conditional<const_iter,
+                                                       const ChunkLink*,
+                                                       ChunkLink*>::type;
+        using chunk_pointer = typename std::conditional<const_iter,
+                                                        const Chunk*,
+                                                        Chunk*>::type;
         using difference_type   = ptrdiff_t;
-        using iterator_category = std::bidirectional_iterator_tag;
+        using iterator_category = std::random_access_iterator_tag;
         using const_reference   = const value_type&;
 
         // Operations
         Iterator& operator++();
         Iterator& operator--();
+        Iterator operator++(int);
+        Iterator operator--(int);
         reference operator*() const;
         bool operator==(const Iterator& rhs) const;
         bool operator!=(const Iterator& rhs) const;
 
+        // Random access
+        Iterator& operator+=(difference_type n);
+        Iterator& operator-=(difference_type n);
+        Iterator operator+(difference_type n) const;
+        Iterator operator-(difference_type n) const;
+        reference operator[](difference_type n) const;
+
+        friend Iterator operator+(difference_type n, const Iterator& i)
+        {
+            return i + n;
+        }
+
+        // Ordering, by position in the string
+        bool operator<(const Iterator& rhs) const;
+        bool operator>(const Iterator& rhs) const;
+        bool operator<=(const Iterator& rhs) const;
+        bool operator>=(const Iterator& rhs) const;
+
+        /**
+         * \brief Number of characters from rhs to this iterator
+         *
+         * \note logarithmic time for indexed strings (see iterator_at),
+         *       otherwise linear in the number of Chunks in between
+         */
+        difference_type operator-(const Iterator& rhs) const;
+
     private:
-        friend class ChunkyString;
-        friend struct Chunk;
-        Iterator(list_iterator_type chunk_, size_t charInd_);
-        list_iterator_type chunk_;
+        friend class BasicChunkyString;
+        Iterator(link_pointer chunk_, size_t charInd_);
+
+        /// The Chunk we point into; not valid for end()
+        chunk_pointer chunk() const;
+
+        /// Jumps longer than this use the index, if there is one
+        static const size_t FAR_JUMP = 8 * ChunkSize;
+
+        /// Move to position pos of an indexed string.
+        void jumpTo(size_t pos);
+
+        /**
+         * \brief Count the characters from `from` forward to `to`.
+         *
+         * \returns false if `to` can't be reached before the end
+         */
+        static bool walk(const Iterator& from, const Iterator& to,
+                         difference_type& dist);
+
+        link_pointer chunk_;
         size_t charInd_;
     };
+
+    /**
+     * \class Segment
+     * \brief A run of characters that are contiguous in memory.
+     *
+     * \details Plays the part of a string_view (or, for non-const
+     *          strings, a span) over one Chunk.
+     */
+    template <typename SegCharT>
+    class Segment {
+    public:
+        Segment(SegCharT* data, size_t size);
+
+        SegCharT* data() const;   ///< First character of the run
+        size_t size() const;      ///< Number of characters in the run
+
+        // Iterate over the characters, e.g. with a range-based for
+        SegCharT* begin() const;
+        SegCharT* end() const;
+
+    private:
+        SegCharT* data_;
+        size_t size_;
+    };
+
+    /**
+     * \class SegmentIterator
+     * \brief Forward iterator over a ChunkyString's Segments.
+     *
+     * \details Dereferencing yields a Segment by value.
+     */
+    template <bool const_seg>
+    class SegmentIterator {
+    public:
+        using value_type = typename std::conditional<const_seg,
+                                                     const_segment,
+                                                     segment>::type;
+        using reference = value_type;
+        using pointer = void;
+        using link_pointer = typename std::conditional<const_seg,
+                                                       const ChunkLink*,
+                                                       ChunkLink*>::type;
+        using chunk_pointer = typename std::conditional<const_seg,
+                                                        const Chunk*,
+                                                        Chunk*>::type;
+        using difference_type   = ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        SegmentIterator& operator++();
+        SegmentIterator operator++(int);
+        value_type operator*() const;
+        bool operator==(const SegmentIterator& rhs) const;
+        bool operator!=(const SegmentIterator& rhs) const;
+
+    private:
+        friend class BasicChunkyString;
+        explicit SegmentIterator(link_pointer chunk);
+
+        link_pointer chunk_;
+    };
+
+    /**
+     * \class SegmentRange
+     * \brief What segments() returns: a begin/end pair of
+     *        SegmentIterators, for use with range-based for.
+     */
+    template <bool const_seg>
+    class SegmentRange {
+    public:
+        SegmentIterator<const_seg> begin() const;
+        SegmentIterator<const_seg> end() const;
+
+    private:
+        friend class BasicChunkyString;
+        using link_pointer =
+            typename SegmentIterator<const_seg>::link_pointer;
+        SegmentRange(link_pointer first, link_pointer head);
+
+        link_pointer first_;
+        link_pointer head_;
+    };
 };
 
+/// The string type used throughout the message passer.
+using ChunkyString = BasicChunkyString<char, 12>;
+
+/// Exchange two strings' contents \note constant time, never throws
+template <typename CharT, size_t ChunkSize>
+void swap(BasicChunkyString<CharT, ChunkSize>& lhs,
+          BasicChunkyString<CharT, ChunkSize>& rhs) noexcept;
+
+/**
+ * \brief String concatenation
+ *
+ * \note linear in the sizes of both strings, except that an rvalue
+ *       argument hands over its Chunks instead of having them copied
+ */
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>
+    operator+(const BasicChunkyString<CharT, ChunkSize>& lhs,
+              const BasicChunkyString<CharT, ChunkSize>& rhs);
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>
+    operator+(BasicChunkyString<CharT, ChunkSize>&& lhs,
+              const BasicChunkyString<CharT, ChunkSize>& rhs);
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>
+    operator+(const BasicChunkyString<CharT, ChunkSize>& lhs,
+              BasicChunkyString<CharT, ChunkSize>&& rhs);
+template <typename CharT, size_t ChunkSize>
+BasicChunkyString<CharT, ChunkSize>
+    operator+(BasicChunkyString<CharT, ChunkSize>&& lhs,
+              BasicChunkyString<CharT, ChunkSize>&& rhs);
+
 /**
  * \brief Print operator: displays a ChunkyString on the given stream
- * 
+ *
  * \param out   the display stream
  * \param text  a ChunkyString to display
- * 
+ *
  * \returns the display stream
+ *
+ * \note one ostream::write per Chunk; like write, ignores the stream's
+ *       width and fill settings
  */
-std::ostream& operator<<(std::ostream& out, const ChunkyString& text);
+template <typename CharT, size_t ChunkSize>
+std::basic_ostream<CharT>& operator<<(std::basic_ostream<CharT>& out,
+                            const BasicChunkyString<CharT, ChunkSize>& text);
 
+#include "chunkystring-private.hpp"
 #include "iterator-private.hpp"
+#include "segment-private.hpp"
 
 #endif // CHUNKYSTRING_HPP_INCLUDED
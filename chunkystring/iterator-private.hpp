@@ -1,5 +1,5 @@
 /*********************************************************************
- * ChunkyString::Iterator class.
+ * BasicChunkyString::Iterator class.
  *********************************************************************
  *
  * Implementation for the templated ChunkyString iterator
@@ -8,39 +8,45 @@
 
 #include <stdexcept>
 
+template <typename CharT, size_t ChunkSize>
 template <bool const_it>
-ChunkyString::Iterator<const_it>::Iterator()
+BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::Iterator()
 {
     // Nothing to do here..
 }
 
+template <typename CharT, size_t ChunkSize>
 template <bool const_it>
-ChunkyString::Iterator<const_it>::Iterator(list_iterator_type chunk,
-                                             size_t charIndex)
+BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::Iterator(
+                                link_pointer chunk, size_t charIndex)
 {
     chunk_ = chunk;
     charInd_ = charIndex;
 }
 
+template <typename CharT, size_t ChunkSize>
 template <bool const_it>
-ChunkyString::Iterator<const_it>::Iterator(const Iterator<false>& i)
+BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::Iterator(
+                                const Iterator<false>& i)
     : chunk_{i.chunk_}, charInd_{i.charInd_}
 {
     // Nothing to do here!
 }
 
+template <typename CharT, size_t ChunkSize>
 template <bool const_it>
-ChunkyString::Iterator<const_it>& ChunkyString::Iterator<const_it>::operator++()
+typename BasicChunkyString<CharT, ChunkSize>::template Iterator<const_it>&
+    BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator++()
 {
     // sets the iterator to point to the next char in the ChunkyString
 
     // case for iterator points to last char in Chunk
-    if(charInd_ == chunk_->length_-1)
+    if(charInd_ == chunk()->length_-1)
     {
         // set iterator to point to first char of next Chunk
         // if iterator pointed to last char, it will be equal to the
         // end iterator
-        ++chunk_;
+        chunk_ = chunk_->next_;
         charInd_ = 0;
     }
     else
@@ -50,16 +56,17 @@ ChunkyString::Iterator<const_it>& ChunkyString::Iterator<const_it>::operator++()
     return *this;
 }
 
+template <typename CharT, size_t ChunkSize>
 template <bool const_it>
-ChunkyString::Iterator<const_it>& 
-    ChunkyString::Iterator<const_it>::operator--()
+typename BasicChunkyString<CharT, ChunkSize>::template Iterator<const_it>&
+    BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator--()
 {
     // sets the iterator to point to the previous char in ChunkyString
 
     if (charInd_ == 0)
     {
-        --chunk_;
-        charInd_ = chunk_->length_-1;
+        chunk_ = chunk_->prev_;
+        charInd_ = chunk()->length_-1;
     }
     else
     {
@@ -68,25 +75,253 @@ ChunkyString::Iterator<const_it>&
     return *this;
 }
 
+template <typename CharT, size_t ChunkSize>
 template <bool const_it>
-typename ChunkyString::Iterator<const_it>::reference 
-    ChunkyString::Iterator<const_it>::operator*() const
+typename BasicChunkyString<CharT, ChunkSize>::template Iterator<const_it>
+    BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator++(int)
+{
+    Iterator old = *this;
+    ++*this;
+    return old;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_it>
+typename BasicChunkyString<CharT, ChunkSize>::template Iterator<const_it>
+    BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator--(int)
+{
+    Iterator old = *this;
+    --*this;
+    return old;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_it>
+typename BasicChunkyString<CharT, ChunkSize>::template
+    Iterator<const_it>::reference 
+    BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator*() const
 {
     // Return the char curr_ points to
-    return chunk_->chars_[charInd_];
+    return chunk()->chars_[charInd_];
 }
 
+template <typename CharT, size_t ChunkSize>
 template <bool const_it>
-bool ChunkyString::Iterator<const_it>::operator==(const Iterator& rhs) const
+bool BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator==(
+                                const Iterator& rhs) const
 {
     // Checks if two iterators hold the same Chunk address and same
     // location within the array
     return chunk_ == rhs.chunk_ && charInd_ == rhs.charInd_;  
 }
 
+template <typename CharT, size_t ChunkSize>
 template <bool const_it>
-bool ChunkyString::Iterator<const_it>::operator!=(const Iterator& rhs) const
+bool BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator!=(
+                                const Iterator& rhs) const
 {
     // leverage == to implement !=
     return !(*this == rhs); 
 }
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_it>
+typename BasicChunkyString<CharT, ChunkSize>::template Iterator<const_it>&
+    BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator+=(
+                                difference_type n)
+{
+    if (n < 0)
+    {
+        return *this -= -n;
+    }
+
+    if (size_t(n) > FAR_JUMP && isIndexed(chunk_))
+    {
+        jumpTo(positionOf(chunk_, charInd_) + n);
+        return *this;
+    }
+
+    // skip every Chunk that ends before our target
+    size_t target = charInd_ + n;
+    while (!isHead(chunk_) && target >= chunk()->length_)
+    {
+        target -= chunk()->length_;
+        chunk_ = chunk_->next_;
+    }
+    charInd_ = target;
+
+    return *this;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_it>
+typename BasicChunkyString<CharT, ChunkSize>::template Iterator<const_it>&
+    BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator-=(
+                                difference_type n)
+{
+    if (n < 0)
+    {
+        return *this += -n;
+    }
+
+    if (size_t(n) > FAR_JUMP && isIndexed(chunk_))
+    {
+        jumpTo(positionOf(chunk_, charInd_) - n);
+        return *this;
+    }
+
+    // skip back over every Chunk that starts after our target
+    size_t back = n;
+    while (back > charInd_)
+    {
+        back -= charInd_ + 1;
+        chunk_ = chunk_->prev_;
+        charInd_ = chunk()->length_ - 1;
+    }
+    charInd_ -= back;
+
+    return *this;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_it>
+typename BasicChunkyString<CharT, ChunkSize>::template Iterator<const_it>
+    BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator+(
+                                difference_type n) const
+{
+    Iterator moved = *this;
+    moved += n;
+    return moved;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_it>
+typename BasicChunkyString<CharT, ChunkSize>::template Iterator<const_it>
+    BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator-(
+                                difference_type n) const
+{
+    Iterator moved = *this;
+    moved -= n;
+    return moved;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_it>
+typename BasicChunkyString<CharT, ChunkSize>::template
+    Iterator<const_it>::reference
+    BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator[](
+                                difference_type n) const
+{
+    return *(*this + n);
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_it>
+bool BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator<(
+                                const Iterator& rhs) const
+{
+    return *this - rhs < 0;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_it>
+bool BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator>(
+                                const Iterator& rhs) const
+{
+    return rhs < *this;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_it>
+bool BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator<=(
+                                const Iterator& rhs) const
+{
+    return !(rhs < *this);
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_it>
+bool BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator>=(
+                                const Iterator& rhs) const
+{
+    return !(*this < rhs);
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_it>
+typename BasicChunkyString<CharT, ChunkSize>::template
+    Iterator<const_it>::difference_type
+    BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::operator-(
+                                const Iterator& rhs) const
+{
+    // an indexed string can tell us both positions directly
+    if (isIndexed(chunk_))
+    {
+        return difference_type(positionOf(chunk_, charInd_))
+             - difference_type(positionOf(rhs.chunk_, rhs.charInd_));
+    }
+
+    // otherwise count whole Chunks, in whichever direction gets there
+    difference_type dist;
+    if (walk(rhs, *this, dist))
+    {
+        return dist;
+    }
+    walk(*this, rhs, dist);
+    return -dist;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_it>
+const size_t BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::FAR_JUMP;
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_it>
+void BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::jumpTo(
+                                size_t pos)
+{
+    ChunkHead* head = headOf(chunk_);
+
+    if (pos == weightOf(head->root_))
+    {
+        chunk_ = head;
+        charInd_ = 0;
+    }
+    else
+    {
+        chunk_ = seek(head->root_, pos);
+        charInd_ = pos;
+    }
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_it>
+bool BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::walk(
+                const Iterator& from, const Iterator& to, difference_type& dist)
+{
+    link_pointer link = from.chunk_;
+    dist = -difference_type(from.charInd_);
+
+    while (link != to.chunk_)
+    {
+        if (isHead(link))
+        {
+            return false;
+        }
+        dist += static_cast<chunk_pointer>(link)->length_;
+        link = link->next_;
+    }
+
+    dist += to.charInd_;
+    return true;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_it>
+typename BasicChunkyString<CharT, ChunkSize>::template
+    Iterator<const_it>::chunk_pointer
+    BasicChunkyString<CharT, ChunkSize>::Iterator<const_it>::chunk() const
+{
+    // every link but the sentinel is the base of a Chunk
+    return static_cast<chunk_pointer>(chunk_);
+}
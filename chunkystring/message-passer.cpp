@@ -3,14 +3,62 @@
  * \author CS70 Provided Code
  */
 
-#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <fstream>
+#include <iostream>
+#include <list>
+#include <mutex>
 #include <random>
+#include <set>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "bounded-queue.hpp"
 #include "chunkystring.hpp"
+#include "chunkystring-io.hpp"
 #include "noisy-transmission.hpp"
 
 using namespace std;
 
+/**
+ * \brief Add path to filenames, or, if it names a directory, the
+ *        regular files in it, in name order.
+ *
+ *   Will return with an exit error of 2 if the directory can't be read.
+ */
+void addFiles(const string& path, vector<string>& filenames)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) < 0 || !S_ISDIR(info.st_mode)) {
+        // anything else is left for the loader to complain about
+        filenames.push_back(path);
+        return;
+    }
+
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        cerr << "Unable to read directory " << path << endl;
+        exit(2);
+    }
+    vector<string> found;
+    while (dirent* entry = readdir(dir)) {
+        string file = path + "/" + entry->d_name;
+        if (stat(file.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+            found.push_back(file);
+        }
+    }
+    closedir(dir);
+
+    sort(found.begin(), found.end());
+    filenames.insert(filenames.end(), found.begin(), found.end());
+}
+
 /**
  * \brief Option Processing
  * \details
@@ -20,12 +68,28 @@ using namespace std;
  *   Will return with an exit error of 2 if receives a usage problem.
  *
  * \param options       Input of options from command line.
- * \param filename      Name of file to read original message from
+ * \param filenames     Names of files to read original messages from, or
+ *                      - for standard input
+ * \param outputDir     Directory to write each file's message to, or
+ *                      empty for standard output
  * \param noiseLevel    Likelihood of a character being modified
+ * \param mapInput      Whether to map the file rather than read it
+ * \param threads       Number of threads to transmit with
+ * \param seed          Seed for the noise, or negative to pick one at random
+ * \param sampling      How to pick the characters to corrupt
+ * \param generator     Which random number generator to corrupt them with
+ * \param stream        Whether to transmit the message a shard at a time
  */
 void processOptions(list<string> options,
-		    string& filename,
-                    float& noiseLevel)
+                    vector<string>& filenames,
+                    string& outputDir,
+                    float& noiseLevel,
+                    bool& mapInput,
+                    unsigned& threads,
+                    long& seed,
+                    NoisyTransmission::Sampling& sampling,
+                    NoisyTransmission::Generator& generator,
+                    bool& stream)
 {
 
     // Takes two things off the list at a time. The first one is a flag, the
@@ -37,6 +101,12 @@ void processOptions(list<string> options,
         flag = options.front();
         options.pop_front();
 
+        // the one flag without a value
+        if (flag == "--stream") {
+            stream = true;
+            continue;
+        }
+
         if (options.empty()) {
             cerr << "Empty argument" << endl;
             exit(2);
@@ -48,18 +118,270 @@ void processOptions(list<string> options,
 	if (flag == "-n" || flag == "--noise") {
 	    noiseLevel = stof(value);
         } else if (flag == "-f" || flag == "--filename") {
-            filename = value;
+            addFiles(value, filenames);
+        } else if (flag == "-F" || flag == "--file-list") {
+            ifstream fileList(value);
+            if (!fileList) {
+                cerr << "Unable to read file list " << value << endl;
+                exit(2);
+            }
+            for (string line; getline(fileList, line); ) {
+                if (!line.empty()) {
+                    addFiles(line, filenames);
+                }
+            }
+        } else if (flag == "-o" || flag == "--output") {
+            outputDir = value;
+        } else if ((flag == "-l" || flag == "--load")
+                   && (value == "read" || value == "mmap")) {
+            mapInput = value == "mmap";
+        } else if (flag == "-j" || flag == "--threads") {
+            threads = stoul(value);
+        } else if (flag == "-s" || flag == "--seed") {
+            seed = stol(value);
+        } else if ((flag == "-m" || flag == "--sampling")
+                   && (value == "each" || value == "skip")) {
+            sampling = value == "each"
+                ? NoisyTransmission::Sampling::EACH_CHARACTER
+                : NoisyTransmission::Sampling::GEOMETRIC_SKIP;
+        } else if ((flag == "-g" || flag == "--generator")
+                   && (value == "mt19937" || value == "xoshiro"
+                       || value == "pcg")) {
+            generator = value == "mt19937"
+                ? NoisyTransmission::Generator::MT19937
+                : value == "xoshiro"
+                    ? NoisyTransmission::Generator::XOSHIRO256PP
+                    : NoisyTransmission::Generator::PCG32;
         } else {
             cerr << "Unrecognized option: " << flag << endl;
-            cerr << "Usage: ./messagePasser -n noise -f filename" << endl;
+            cerr << "Usage: ./messagePasser -n noise -f filename... "
+                    "[-F filelist] [-o outputdir] [-l read|mmap] "
+                    "[-j threads] [-s seed] [-m each|skip] "
+                    "[-g mt19937|xoshiro|pcg] [--stream]" << endl;
             exit(2);
         }
     }
 
-    if (filename.empty()) {
+    if (filenames.empty()) {
         cerr << "Filename not specfied" << endl;
         exit(2);
     }
+    if (filenames.size() > 1 && outputDir.empty()) {
+        cerr << "Several files need an output directory" << endl;
+        exit(2);
+    }
+}
+
+
+
+/**
+ * \brief Transmit everything that can be read from in to out, a shard
+ *        at a time.
+ *
+ * \details Reading, transmitting and writing overlap on three threads
+ *   joined by short queues, so memory use stays at a handful of shards
+ *   however long the input is, and output starts after the first shard.
+ *   The output is the same as transmitting the whole message at once.
+ *
+ * \throws std::system_error  if reading or writing fails
+ * \throws std::bad_alloc     if a shard can't be transmitted for lack of
+ *                            memory
+ */
+void streamMessage(int in, int out, NoisyTransmission& transmissionLine)
+{
+    // enough shards in flight to ride out a slow read or write
+    const size_t QUEUE_DEPTH = 2;
+    BoundedQueue<ChunkyString> sent(QUEUE_DEPTH);
+    BoundedQueue<ChunkyString> received(QUEUE_DEPTH);
+    uint64_t base = transmissionLine.startShards();
+
+    exception_ptr readError;
+    thread reader([&] {
+        try {
+            size_t shardSize = transmissionLine.shardSize();
+            size_t got = shardSize;
+            while (got == shardSize) {
+                ChunkyString block;
+                block.reserve(shardSize);
+                got = readFrom(in, block, shardSize);
+                if (got == 0 || !sent.push(move(block))) {
+                    break;
+                }
+            }
+        } catch (...) {
+            readError = current_exception();
+        }
+        sent.close();
+    });
+
+    exception_ptr transmitError;
+    thread transmitter([&] {
+        try {
+            ChunkyString block;
+            for (size_t shard = 0; sent.pop(block); ++shard) {
+                if (!received.push(transmissionLine.transmittedShard(
+                                       block, base, shard))) {
+                    break;
+                }
+            }
+        } catch (...) {
+            transmitError = current_exception();
+        }
+        // if the writer gave up, stop the reader too, and if we did, stop
+        // them both
+        sent.close();
+        received.close();
+    });
+
+    exception_ptr writeError;
+    try {
+        ChunkyString block;
+        while (received.pop(block)) {
+            writeTo(out, block);
+        }
+    } catch (...) {
+        writeError = current_exception();
+        received.close();
+    }
+
+    transmitter.join();
+    reader.join();
+    if (readError) {
+        rethrow_exception(readError);
+    }
+    if (transmitError) {
+        rethrow_exception(transmitError);
+    }
+    if (writeError) {
+        rethrow_exception(writeError);
+    }
+}
+
+
+
+/**
+ * \brief Transmit the file at path into the file of the same name in
+ *        outputDir, replacing it.
+ *
+ * \details The output is exactly what messagepasser would print for the
+ *   file on its own, trailing newline included.
+ *
+ * \throws std::system_error  if a file can't be opened, read or written
+ */
+void transmitFile(const string& path, const string& outputDir,
+                  bool mapInput, bool stream,
+                  NoisyTransmission& transmissionLine)
+{
+    string name = path.substr(path.find_last_of('/') + 1);
+    string outPath = outputDir + "/" + name;
+    int out = open(outPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (out < 0) {
+        throw system_error(errno, generic_category(), outPath);
+    }
+
+    try {
+        ChunkyString message;
+        if (stream) {
+            int in = open(path.c_str(), O_RDONLY);
+            if (in < 0) {
+                throw system_error(errno, generic_category(), path);
+            }
+            try {
+                streamMessage(in, out, transmissionLine);
+            } catch (...) {
+                close(in);
+                throw;
+            }
+            close(in);
+        } else {
+            message = mapInput ? mapFile(path) : readFile(path);
+            transmissionLine.transmit(message);
+        }
+        message.push_back('\n');
+        writeTo(out, message);
+    } catch (...) {
+        close(out);
+        throw;
+    }
+    if (close(out) < 0) {
+        throw system_error(errno, generic_category(), outPath);
+    }
+}
+
+/**
+ * \brief Transmit every file in filenames into outputDir, with a pool of
+ *        threads that each take the next file as soon as they are free.
+ *
+ * \details Each file has a NoisyTransmission of its own.  Given a seed,
+ *   file number i on the command line is transmitted with seed + i, so
+ *   its output doesn't depend on the number of threads.
+ *
+ * \returns false if any file failed, after reporting why
+ */
+bool transmitFiles(const vector<string>& filenames, const string& outputDir,
+                   unsigned threads, float noiseLevel, bool mapInput,
+                   long seed, NoisyTransmission::Sampling sampling,
+                   NoisyTransmission::Generator generator, bool stream)
+{
+    set<string> names;
+    for (const string& path : filenames) {
+        if (!names.insert(path.substr(path.find_last_of('/') + 1)).second) {
+            cerr << "Two files would be written to " << outputDir << "/"
+                 << path.substr(path.find_last_of('/') + 1) << endl;
+            return false;
+        }
+    }
+
+    // biggest files first, so no thread is left with a big one at the end
+    vector<pair<off_t, size_t>> order;
+    for (size_t i = 0; i < filenames.size(); ++i) {
+        struct stat info;
+        off_t size = stat(filenames[i].c_str(), &info) == 0 ? info.st_size
+                                                            : 0;
+        order.emplace_back(size, i);
+    }
+    sort(order.begin(), order.end(), [](const pair<off_t, size_t>& lhs,
+                                        const pair<off_t, size_t>& rhs) {
+        return lhs.first > rhs.first;
+    });
+
+    atomic<size_t> next(0);
+    atomic<bool> ok(true);
+    mutex errorLock;
+    auto worker = [&]() {
+        for (size_t job = next++; job < order.size(); job = next++) {
+            size_t i = order[job].second;
+            // an exception escaping a thread would end the whole run, so
+            // any failure just marks this file and moves on to the next
+            try {
+                NoisyTransmission transmissionLine =
+                    seed < 0
+                        ? NoisyTransmission{noiseLevel, sampling, generator}
+                        : NoisyTransmission{noiseLevel, uint64_t(seed) + i,
+                                            sampling, generator};
+                transmitFile(filenames[i], outputDir, mapInput, stream,
+                             transmissionLine);
+            } catch (const exception& err) {
+                // a system_error's what() names the path that failed,
+                // which may be the output file rather than the input
+                lock_guard<mutex> lock(errorLock);
+                cerr << "Unable to transmit " << filenames[i] << ": "
+                     << err.what() << endl;
+                ok = false;
+            }
+        }
+    };
+
+    vector<thread> pool;
+    size_t workers = min(size_t(threads), filenames.size());
+    for (size_t i = 1; i < workers; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (thread& t : pool) {
+        t.join();
+    }
+    return ok;
 }
 
 
@@ -67,34 +389,88 @@ void processOptions(list<string> options,
 int main(int argc, const char* argv[])
 {
     float noiseLevel = 0;
-    string fileName;
+    vector<string> fileNames;
+    string outputDir;
+    bool mapInput = false;
+    unsigned threads = 0;   // one per file, or per core, unless told
+    long seed = -1;
+    // skipping costs time in proportion to the errors, not the message
+    NoisyTransmission::Sampling sampling =
+        NoisyTransmission::Sampling::GEOMETRIC_SKIP;
+    NoisyTransmission::Generator generator =
+        NoisyTransmission::Generator::XOSHIRO256PP;
+    bool stream = false;
 
     // Construct a list of options that goes from the 2nd element of argv to
     // the last one. We don't care about the first element because it's just
     // the name of the program
     list<string> options(argv + 1, argv + argc);
-    processOptions(options, fileName, noiseLevel);
-
-    ifstream fileReader( fileName );
+    processOptions(options, fileNames, outputDir, noiseLevel, mapInput,
+                   threads, seed, sampling, generator, stream);
 
-    if (!fileReader.is_open()) {
-        // The file could not be opened
-        cerr << "Unable to read from file" << fileName << endl;
-        exit(1);
-    } else {
-        // Safely use the file stream
-        ChunkyString message;
+    if (!outputDir.empty()) {
+        if (threads == 0) {
+            threads = max(thread::hardware_concurrency(), 1u);
+        }
+        return transmitFiles(fileNames, outputDir, threads, noiseLevel,
+                             mapInput, seed, sampling, generator, stream)
+               ? 0 : 1;
+    }
+    string fileName = fileNames.front();
 
-        char c;
-	while (fileReader.get(c)) {
-  	    message.push_back(c);
-	}
-	
-	NoisyTransmission transmissionLine{noiseLevel};
-	transmissionLine.transmit(message);
+    NoisyTransmission transmissionLine =
+        seed < 0 ? NoisyTransmission{noiseLevel, sampling, generator}
+                 : NoisyTransmission{noiseLevel, uint64_t(seed), sampling,
+                                     generator};
 
-        cout << message << endl;
+    if (stream) {
+        int fd = fileName == "-" ? STDIN_FILENO
+                                 : open(fileName.c_str(), O_RDONLY);
+        try {
+            if (fd < 0) {
+                throw system_error(errno, generic_category(), fileName);
+            }
+            cout.flush();
+            streamMessage(fd, STDOUT_FILENO, transmissionLine);
+            close(fd);
+        } catch (const system_error& err) {
+            cerr << "Unable to transmit " << fileName << ": "
+                 << err.code().message() << endl;
+            exit(1);
+        } catch (const exception& err) {
+            cerr << "Unable to transmit " << fileName << ": "
+                 << err.what() << endl;
+            exit(1);
+        }
+        cout << endl;
         return 0;
     }
 
+    ChunkyString message;
+    try {
+        if (fileName == "-") {
+            readFrom(STDIN_FILENO, message);
+        } else {
+            // a mapped message only takes memory for the parts that change
+            message = mapInput ? mapFile(fileName) : readFile(fileName);
+        }
+    } catch (const system_error& err) {
+        // The file could not be opened or read
+        cerr << "Unable to read from file " << fileName << ": "
+             << err.code().message() << endl;
+        exit(1);
+    }
+    if (threads > 1) {
+        // same result as transmit, but shards are transformed into new
+        // strings side by side and then joined up
+        message = transmissionLine.transmitted(message, threads);
+    } else {
+        transmissionLine.transmit(message);
+    }
+
+    // bypass cout's buffer and hand the Chunks straight to the OS
+    cout.flush();
+    writeTo(STDOUT_FILENO, message);
+    cout << endl;
+    return 0;
 }
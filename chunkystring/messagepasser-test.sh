@@ -0,0 +1,64 @@
+#!/bin/sh
+#
+# Tests messagepasser's batch mode (-f ... -o dir): with a seed, file
+# number i on the command line is transmitted with seed + i, so each
+# output file must match a run on that file alone with that seed.  Also
+# checks that a failure names the path that failed.
+#
+# Usage: ./messagepasser-test.sh  (after make messagepasser; make test
+#        runs it)
+
+PASSER=./messagepasser
+SEED=11
+
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+mkdir "$dir/in"
+
+# files of a few shards, one shard, a few characters, and nothing at all
+seq 1 300000 > "$dir/in/long"
+seq 7 3 40000 > "$dir/in/medium"
+printf 'A short message' > "$dir/in/short"
+: > "$dir/in/empty"
+FILES="long medium short empty"
+
+failures=0
+fail()
+{
+    echo "FAILED: $*"
+    failures=$((failures + 1))
+}
+
+for mode in "" "--stream"; do
+    how=${mode:-"whole files"}
+    mkdir "$dir/out"
+    args=""
+    for name in $FILES; do
+        args="$args -f $dir/in/$name"
+    done
+    $PASSER -n 0.05 -s $SEED -j 3 $mode $args -o "$dir/out" \
+        || fail "batch run ($how) exited with $?"
+
+    i=0
+    for name in $FILES; do
+        $PASSER -n 0.05 -s $((SEED + i)) $mode -f "$dir/in/$name" \
+            > "$dir/single" || fail "single run of $name ($how)"
+        cmp -s "$dir/single" "$dir/out/$name" \
+            || fail "$name ($how) differs from a run with seed $((SEED + i))"
+        i=$((i + 1))
+    done
+    rm -r "$dir/out"
+done
+
+# the output directory is what's missing, so that's what must be named
+if $PASSER -n 0.05 -f "$dir/in/short" -o "$dir/missing" 2> "$dir/errors"
+then
+    fail "writing into a missing directory succeeded"
+elif ! grep -q "$dir/missing/short" "$dir/errors"; then
+    fail "error doesn't name the output path: $(cat "$dir/errors")"
+fi
+
+if [ $failures -eq 0 ]; then
+    echo "messagepasser batch tests passed"
+fi
+[ $failures -eq 0 ]
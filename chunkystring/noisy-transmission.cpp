@@ -15,36 +15,433 @@
 #include <iostream>
 #include <fstream>
 #include <random>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
 #include "chunkystring.hpp"
 #include "noisy-transmission.hpp"
 
-NoisyTransmission::NoisyTransmission(float errorRate) : errorRate_(errorRate), dis_(0,1) {
+NoisyTransmission::NoisyTransmission(float errorRate, Sampling sampling, Generator generator) : errorRate_(errorRate), sampling_(sampling), generator_(generator), shardSize_(SHARD_SIZE), xoshiro_(0), pcg_(0, 0) {
     seed();
 }
 
+NoisyTransmission::NoisyTransmission(float errorRate, std::uint64_t seed,
+                                     Sampling sampling, Generator generator)
+    : errorRate_(errorRate), sampling_(sampling), generator_(generator),
+      shardSize_(SHARD_SIZE), xoshiro_(0), pcg_(0, 0)
+{
+    this->seed(seed);
+}
+
+const size_t NoisyTransmission::SHARD_SIZE;
+
+size_t NoisyTransmission::shardSize() const
+{
+	return shardSize_;
+}
+
+void NoisyTransmission::setShardSize(size_t size)
+{
+	if(size == 0)
+	{
+		throw std::invalid_argument("NoisyTransmission: empty shards");
+	}
+	shardSize_ = size;
+}
+
 void NoisyTransmission::seed() {
     std::random_device rd;
-    gen_.seed(rd());
+    std::uint64_t high = rd();
+    seed((high << 32) | rd());
+}
+
+void NoisyTransmission::seed(std::uint64_t seed)
+{
+	// mt19937 takes 32 bits at a time, so hand it both halves
+	std::seed_seq seq{std::uint32_t(seed), std::uint32_t(seed >> 32)};
+	gen_.seed(seq);
+	xoshiro_ = Xoshiro256pp(seed);
+	pcg_ = Pcg32(seed, 0);
 }
 
 float NoisyTransmission::getRandomFloat() {
-    return dis_(gen_);
+	switch(generator_)
+	{
+	case Generator::XOSHIRO256PP:
+		return randomFloat(xoshiro_);
+	case Generator::PCG32:
+		return randomFloat(pcg_);
+	default:
+		return randomFloat(gen_);
+	}
+}
+
+void NoisyTransmission::fillRandom(float* probs, size_t count)
+{
+	switch(generator_)
+	{
+	case Generator::XOSHIRO256PP:
+		::fillRandom(xoshiro_, probs, count);
+		break;
+	case Generator::PCG32:
+		::fillRandom(pcg_, probs, count);
+		break;
+	default:
+		::fillRandom(gen_, probs, count);
+		break;
+	}
 }
 
+template <typename Gen>
+class NoisyTransmission::Sampler {
+public:
+	Sampler(const NoisyTransmission& line, Gen gen)
+		: gen_(gen), sampling_(line.sampling_),
+		  drop_(line.errorRate_), twice_(1 - line.errorRate_),
+		  used_(BATCH_SIZE)
+	{
+		// the same odds as drawing for each character: below errorRate_
+		// drops, and above both 1-errorRate_ and errorRate_ doubles
+		double drop = std::min(std::max(double(line.errorRate_), 0.0), 1.0);
+		double twice = std::max(0.0, 1.0 - std::max(drop, 1.0 - drop));
+		either_ = drop + twice;
+		dropShare_ = either_ > 0 ? float(drop / either_) : 0;
+		logKeep_ = std::log1p(-either_);
+	}
+
+	/// The next Event among the next limit characters
+	Event next(size_t limit)
+	{
+		return sampling_ == Sampling::EACH_CHARACTER ? nextEach(limit)
+		                                             : nextSkip(limit);
+	}
+
+private:
+	static const size_t BATCH_SIZE = 256;
+
+	Event nextEach(size_t limit)
+	{
+		for (size_t gap = 0; gap < limit; ++gap)
+		{
+			if(used_ == BATCH_SIZE)
+			{
+				::fillRandom(gen_, batch_, BATCH_SIZE);
+				used_ = 0;
+			}
+
+			float prob = batch_[used_++];
+			if(prob < drop_)
+			{
+				return Event{gap, Fate::DROP};
+			}
+			else if(prob > twice_)
+			{
+				return Event{gap, Fate::DOUBLE};
+			}
+		}
+		return Event{limit, Fate::KEEP};
+	}
+
+	Event nextSkip(size_t limit)
+	{
+		if(either_ == 0)
+		{
+			return Event{limit, Fate::KEEP};
+		}
+
+		// the characters between corruptions are geometrically
+		// distributed; invert the distribution at a uniform (0, 1]
+		double gap = 0;
+		if(either_ < 1)
+		{
+			double u = 1 - std::generate_canonical<double, 53>(gen_);
+			gap = std::floor(std::log(u) / logKeep_);
+		}
+		if(gap >= double(limit))
+		{
+			return Event{limit, Fate::KEEP};
+		}
+
+		Fate fate = randomFloat(gen_) < dropShare_ ? Fate::DROP
+		                                           : Fate::DOUBLE;
+		return Event{size_t(gap), fate};
+	}
+
+	Gen gen_;
+	Sampling sampling_;
+	float drop_;        // Per character: below this drops...
+	float twice_;       // ...and above this doubles
+	double either_;     // Chance a character is corrupted at all
+	float dropShare_;   // Chance a corruption is a drop
+	double logKeep_;    // log(1 - either_)
+	float batch_[BATCH_SIZE];
+	size_t used_;       // Floats of batch_ already used
+};
+
 void NoisyTransmission::transmit(ChunkyString& message) 
 {
-	float prob = 0;
-	for(ChunkyString::iterator i = message.begin(); i != message.end(); ++i)
+	// the same randomness, shard by shard, as transmitted() would use
+	std::uint64_t base = startShards();
+
+	// the edits work their way along the message, so keep free cells
+	// wherever they are for the next one
+	ChunkyString::CompactionPolicy policy = message.compaction_policy();
+	ChunkyString::CompactionPolicy gaps = policy;
+	gaps.openGaps = true;
+	message.set_compaction_policy(gaps);
+
+	size_t size = message.size();
+	ChunkyString::iterator i = message.begin();
+	for (size_t shard = 0; shard * shardSize_ < size; ++shard)
+	{
+		size_t count = std::min(shardSize_, size - shard * shardSize_);
+		transmitShard(message, i, count, base, shard);
+	}
+	message.set_compaction_policy(policy);
+}
+
+ChunkyString NoisyTransmission::transmitted(const ChunkyString& message)
+{
+	return transmitted(message, 1);
+}
+
+ChunkyString NoisyTransmission::transmitted(const ChunkyString& message,
+                                            unsigned threads)
+{
+	// find where each shard starts, a segment at a time
+	std::vector<std::pair<ChunkyString::const_segment_iterator, size_t>>
+		starts;
+	size_t pos = 0;
+	for (ChunkyString::const_segment_iterator seg = message.segments().begin();
+	     seg != message.segments().end(); ++seg)
+	{
+		size_t length = (*seg).size();
+		for (size_t next = starts.size() * shardSize_; next < pos + length;
+		     next += shardSize_)
+		{
+			starts.emplace_back(seg, next - pos);
+		}
+		pos += length;
+	}
+
+	// one draw from our own generator makes the whole run reproducible
+	std::uint64_t base = startShards();
+
+	std::vector<ChunkyString> shards(starts.size());
+	std::atomic<size_t> nextShard(0);
+	auto worker = [&]() {
+		for (size_t shard = nextShard++; shard < shards.size();
+		     shard = nextShard++)
+		{
+			size_t count = std::min(shardSize_,
+			                        message.size() - shard * shardSize_);
+			transmitShard(starts[shard].first, starts[shard].second,
+			              count, base, shard, shards[shard]);
+		}
+	};
+
+	std::vector<std::thread> pool;
+	size_t workers = std::min(size_t(std::max(threads, 1u)), shards.size());
+	for (size_t i = 1; i < workers; ++i)
+	{
+		pool.emplace_back(worker);
+	}
+	worker();
+	for (std::thread& t : pool)
+	{
+		t.join();
+	}
+
+	ChunkyString received;
+	for (ChunkyString& shard : shards)
+	{
+		received += std::move(shard);
+	}
+	return received;
+}
+
+std::uint64_t NoisyTransmission::startShards()
+{
+	return gen_();
+}
+
+ChunkyString NoisyTransmission::transmittedShard(const ChunkyString& block,
+                                                 std::uint64_t base,
+                                                 size_t shard) const
+{
+	ChunkyString received;
+	if(block.size() > 0)
+	{
+		transmitShard(block.segments().begin(), 0, block.size(), base,
+		              shard, received);
+	}
+	return received;
+}
+
+// Each transmitShard builds the shard's generator and hands it to the
+// version of the work compiled for that generator
+void NoisyTransmission::transmitShard(ChunkyString& message,
+                                      ChunkyString::iterator& i, size_t count,
+                                      std::uint64_t base, size_t shard) const
+{
+	switch(generator_)
+	{
+	case Generator::MT19937:
+	{
+		std::seed_seq seq{std::uint32_t(base), std::uint32_t(base >> 32),
+		                  std::uint32_t(shard)};
+		Sampler<std::mt19937> sampler(*this, std::mt19937(seq));
+		editShard(message, i, count, sampler);
+		break;
+	}
+	case Generator::XOSHIRO256PP:
+	{
+		Sampler<Xoshiro256pp> sampler(*this,
+			Xoshiro256pp(SplitMix64(base ^ SplitMix64(shard)())()));
+		editShard(message, i, count, sampler);
+		break;
+	}
+	case Generator::PCG32:
+	{
+		Sampler<Pcg32> sampler(*this, Pcg32(base, shard));
+		editShard(message, i, count, sampler);
+		break;
+	}
+	}
+}
+
+void NoisyTransmission::transmitShard(
+	ChunkyString::const_segment_iterator seg, size_t offset, size_t count,
+	std::uint64_t base, size_t shard, ChunkyString& received) const
+{
+	// about as much arrives as is sent
+	received.reserve(received.size() + count);
+
+	switch(generator_)
+	{
+	case Generator::MT19937:
+	{
+		std::seed_seq seq{std::uint32_t(base), std::uint32_t(base >> 32),
+		                  std::uint32_t(shard)};
+		Sampler<std::mt19937> sampler(*this, std::mt19937(seq));
+		copyShard(seg, offset, count, sampler, received);
+		break;
+	}
+	case Generator::XOSHIRO256PP:
+	{
+		Sampler<Xoshiro256pp> sampler(*this,
+			Xoshiro256pp(SplitMix64(base ^ SplitMix64(shard)())()));
+		copyShard(seg, offset, count, sampler, received);
+		break;
+	}
+	case Generator::PCG32:
+	{
+		Sampler<Pcg32> sampler(*this, Pcg32(base, shard));
+		copyShard(seg, offset, count, sampler, received);
+		break;
+	}
+	}
+}
+
+template <typename Gen>
+void NoisyTransmission::editShard(ChunkyString& message,
+                                  ChunkyString::iterator& i, size_t count,
+                                  Sampler<Gen>& sampler) const
+{
+	while(count > 0)
 	{
-		prob = getRandomFloat();
-		if(prob < errorRate_)
+		// jump straight over the characters that arrive unchanged
+		Event event = sampler.next(count);
+		i += event.gap;
+		count -= event.gap;
+		if(event.fate == Fate::KEEP)
+		{
+			continue;
+		}
+
+		--count;
+		if(event.fate == Fate::DROP)
 		{
-			message.erase(i);
+			// erase hands back the character after the dropped one
+			i = message.erase(i);
 		}
-		else if(prob > 1-errorRate_)
+		else
 		{
+			// step over the copy so it isn't transmitted again
 			char toInsert = *i;
-			message.insert(i, toInsert);
+			i = message.insert(i, toInsert);
+			i += 2;
+		}
+	}
+}
+
+template <typename Gen>
+void NoisyTransmission::copyShard(ChunkyString::const_segment_iterator seg,
+                                  size_t offset, size_t count,
+                                  Sampler<Gen>& sampler,
+                                  ChunkyString& received) const
+{
+	// what arrives is gathered in a small block that is appended to the
+	// result whole, so unchanged runs cost a copy rather than inserts
+	const size_t BLOCK_SIZE = 4096;
+	char block[BLOCK_SIZE];
+	size_t used = 0;
+	auto send = [&](const char* chars, size_t length) {
+		while(length > 0)
+		{
+			if(used == BLOCK_SIZE)
+			{
+				received.insert(received.end(), block, used);
+				used = 0;
+			}
+			size_t piece = std::min(length, BLOCK_SIZE - used);
+			std::copy(chars, chars + piece, block + used);
+			used += piece;
+			chars += piece;
+			length -= piece;
+		}
+	};
+
+	ChunkyString::const_segment chars = *seg;
+	const char* c = chars.begin() + offset;
+	while(count > 0)
+	{
+		Event event = sampler.next(count);
+		count -= event.gap;
+
+		// send the unchanged run, a segment at a time
+		for (size_t gap = event.gap; gap > 0; )
+		{
+			if(c == chars.end())
+			{
+				chars = *++seg;
+				c = chars.begin();
+			}
+			size_t piece = std::min(gap, size_t(chars.end() - c));
+			send(c, piece);
+			c += piece;
+			gap -= piece;
+		}
+		if(event.fate == Fate::KEEP)
+		{
+			continue;
+		}
+
+		if(c == chars.end())
+		{
+			chars = *++seg;
+			c = chars.begin();
+		}
+		--count;
+		if(event.fate == Fate::DOUBLE)
+		{
+			send(c, 1);
+			send(c, 1);
 		}
+		++c;
 	}
+	received.insert(received.end(), block, used);
 }
@@ -13,20 +13,127 @@
 
 
 #include "chunkystring.hpp"
+#include "random-generators.hpp"
+#include <cstdint>
 #include <random>
 
+/**
+ * \class NoisyTransmission
+ *
+ * \details Every way of transmitting cuts the message into fixed-size
+ *   shards and gives each its own generator, seeded from this object's
+ *   generator and the shard's number.  So for a given seed, transmit,
+ *   transmitted and threaded transmitted all produce the same message,
+ *   whatever the number of threads.
+ */
 class NoisyTransmission {
 public:
-    NoisyTransmission(float errorRate);
+    /// How to decide which characters are corrupted
+    enum class Sampling {
+        EACH_CHARACTER,     ///< Draw a random number for every character
+        GEOMETRIC_SKIP      ///< Draw the distance to the next corruption
+    };
+
+    /// Which generator the shards draw from
+    enum class Generator {
+        MT19937,            ///< std::mt19937
+        XOSHIRO256PP,       ///< xoshiro256++, the fastest
+        PCG32               ///< PCG-XSH-RR, one stream per shard
+    };
+
+    NoisyTransmission(float errorRate,
+                      Sampling sampling = Sampling::EACH_CHARACTER,
+                      Generator generator = Generator::MT19937);
+    /// Draw all randomness from seed, so runs can be reproduced
+    NoisyTransmission(float errorRate, std::uint64_t seed,
+                      Sampling sampling = Sampling::EACH_CHARACTER,
+                      Generator generator = Generator::MT19937);
     void transmit(ChunkyString& message);
+
+    /// Like transmit, but leaves message alone and builds what arrives
+    /// in a single pass, appending it to the result a block at a time.
+    ChunkyString transmitted(const ChunkyString& message);
+
+    /// Like transmitted, but with the shards spread over threads.
+    ChunkyString transmitted(const ChunkyString& message, unsigned threads);
+
+    /// Characters per shard, unless set otherwise
+    static const size_t SHARD_SIZE = size_t(1) << 20;
+
+    /// Characters per shard
+    size_t shardSize() const;
+
+    /// Cut messages into shards of size characters, which must be
+    /// positive.  What arrives depends on the shard size as well as the
+    /// seed.
+    void setShardSize(size_t size);
+
+    /// Begin transmitting a message one shard at a time: draws the
+    /// number that every shard's generator is seeded from.
+    std::uint64_t startShards();
+
+    /// What arrives of block, at most shardSize() characters, when it is
+    /// shard number shard of a message begun with startShards.  Joined
+    /// up, the shards of a message are exactly what transmit gives.
+    ChunkyString transmittedShard(const ChunkyString& block,
+                                  std::uint64_t base, size_t shard) const;
+
+    /// A uniform float in [0, 1), from the generator chosen at
+    /// construction
     float getRandomFloat();
+
+    /// Fill probs with count uniform floats in [0, 1), as getRandomFloat
+    /// would, but much faster than calling it count times.
+    void fillRandom(float* probs, size_t count);
   
 private:
     float errorRate_;
-    std::uniform_real_distribution<> dis_;
-    std::mt19937 gen_;
+    Sampling sampling_;
+    Generator generator_;
+    size_t shardSize_;
+    std::mt19937 gen_;          // Seeds the shards
+    Xoshiro256pp xoshiro_;      // getRandomFloat's draws, for generator_
+    Pcg32 pcg_;                 // ...likewise
 
+    /// Seed every generator from the system's random device
     void seed();
+
+    /// Seed every generator from all 64 bits of seed
+    void seed(std::uint64_t seed);
+
+    /// What happens to a character
+    enum class Fate { KEEP, DROP, DOUBLE };
+
+    /// The next corruption: gap characters arrive unchanged, then one
+    /// character meets its fate
+    struct Event {
+        size_t gap;
+        Fate fate;
+    };
+
+    /// Finds the Events of one shard, using a generator of type Gen
+    template <typename Gen>
+    class Sampler;
+
+    /// Transform the count characters of shard number shard that start
+    /// at i, in place; i is left after them
+    void transmitShard(ChunkyString& message, ChunkyString::iterator& i,
+                       size_t count, std::uint64_t base, size_t shard) const;
+
+    /// Append what arrives of the count characters of shard number shard,
+    /// which start offset characters into *seg, to received
+    void transmitShard(ChunkyString::const_segment_iterator seg,
+                       size_t offset, size_t count, std::uint64_t base,
+                       size_t shard, ChunkyString& received) const;
+
+    // The work of the two transmitShards, for each type of generator
+    template <typename Gen>
+    void editShard(ChunkyString& message, ChunkyString::iterator& i,
+                   size_t count, Sampler<Gen>& sampler) const;
+    template <typename Gen>
+    void copyShard(ChunkyString::const_segment_iterator seg, size_t offset,
+                   size_t count, Sampler<Gen>& sampler,
+                   ChunkyString& received) const;
 };
 
 #endif
@@ -0,0 +1,373 @@
+/**
+ * \file pipeline-bench.cpp
+ *
+ * \brief End-to-end benchmark of messagepasser's pipeline: load a file,
+ *        transmit it, write it out.
+ *
+ * \details
+ *    Generates synthetic corpora of the requested sizes (kept in the
+ *    corpus directory between runs), then, for every size and noise
+ *    level, runs the same stages messagepasser does in a fresh child
+ *    process and prints the results as JSON on standard output:
+ *
+ *      { "runs": [ { "size": ..., "noise": ..., "load": "read",
+ *                    "sampling": "skip", "generator": "xoshiro",
+ *                    "repeat": 0, "peak_rss_kb": ..., "seconds": ...,
+ *                    "stages": { "load": { "seconds": ...,
+ *                                          "mb_per_s": ...,
+ *                                          "allocations": ... },
+ *                                "transmit": { ... },
+ *                                "write": { ... } } }, ... ] }
+ *
+ *    Usage: ./pipeline-bench [-s 1K,1M,64M,1G] [-n 0.001,0.01,0.1]
+ *                            [-l read|mmap] [-m each|skip]
+ *                            [-g mt19937|xoshiro|pcg] [-r repeats]
+ *                            [-d corpusdir]
+ *
+ *    The transmission defaults to messagepasser's, skip sampling with
+ *    xoshiro256++.  Every run is seeded, so runs with the same arguments
+ *    do the same work.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "chunkystring.hpp"
+#include "chunkystring-io.hpp"
+#include "noisy-transmission.hpp"
+#include "allocation-count.hpp"
+
+using namespace std;
+
+//--------------------------------------------------
+//           CORPORA
+//--------------------------------------------------
+
+/// Parse a size such as 4096, 64K, 16M or 1G
+size_t parseSize(const string& text)
+{
+    size_t end;
+    size_t size = stoul(text, &end);
+    switch (end < text.size() ? text[end] : ' ') {
+    case 'G': case 'g':
+        size <<= 10;
+        // fall through
+    case 'M': case 'm':
+        size <<= 10;
+        // fall through
+    case 'K': case 'k':
+        size <<= 10;
+    }
+    return size;
+}
+
+/// Split a comma-separated list
+vector<string> split(const string& text)
+{
+    vector<string> items;
+    stringstream in(text);
+    for (string item; getline(in, item, ','); ) {
+        items.push_back(item);
+    }
+    return items;
+}
+
+/// Parse a comma-separated list of noise levels
+vector<float> parseNoises(const string& text)
+{
+    vector<float> noises;
+    for (const string& item : split(text)) {
+        noises.push_back(stof(item));
+    }
+    return noises;
+}
+
+/**
+ * \brief Write size characters of made-up prose to path, unless a file
+ *        of that size is already there.
+ *
+ * \details Words are drawn from a small vocabulary, with a skewed choice
+ *   of word, line lengths around 70 and the odd paragraph break, which
+ *   is close enough to real text for a transmission that treats every
+ *   character alike.
+ *
+ * \throws std::system_error  if the file can't be written
+ */
+void makeCorpus(const string& path, size_t size)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0 && size_t(info.st_size) == size) {
+        return;
+    }
+
+    static const char* const WORDS[] = {
+        "the", "of", "and", "a", "to", "in", "is", "you", "that", "it",
+        "he", "was", "for", "on", "are", "as", "with", "his", "they", "at",
+        "chunk", "string", "message", "noise", "transmission", "character",
+        "iterator", "allocation", "utilization", "benchmark", "throughput"
+    };
+    const size_t WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+    // the corpus for a size is always the same
+    mt19937 gen(size);
+    geometric_distribution<size_t> pick(0.15);
+
+    ofstream out(path, ios::binary);
+    string line;
+    for (size_t written = 0; written < size && out; ) {
+        string word = WORDS[min(pick(gen), WORD_COUNT - 1)];
+        if (line.size() + word.size() >= 70) {
+            line += gen() % 16 == 0 ? "\n\n" : "\n";
+            size_t piece = min(line.size(), size - written);
+            out.write(line.data(), piece);
+            written += piece;
+            line.clear();
+        }
+        line += line.empty() ? word : " " + word;
+    }
+    if (!out) {
+        throw system_error(errno, generic_category(), path);
+    }
+}
+
+//--------------------------------------------------
+//           RUNS
+//--------------------------------------------------
+
+/// Time and allocations taken by one stage of the pipeline
+struct Stage {
+    double seconds;
+    size_t allocations;
+};
+
+/// What a child process measures and reports to its parent
+struct Measurement {
+    Stage load;
+    Stage transmit;
+    Stage write;
+};
+
+/// How a run transmits its message
+struct Transmission {
+    float noise;
+    NoisyTransmission::Sampling sampling;
+    NoisyTransmission::Generator generator;
+};
+
+/**
+ * \brief Load, transmit and write the file at inPath to outPath, as
+ *        messagepasser does, timing each stage.
+ *
+ * \throws std::system_error  if a file can't be read or written
+ */
+Measurement runPipeline(const string& inPath, const string& outPath,
+                        const Transmission& how, bool mapInput)
+{
+    typedef chrono::steady_clock clock;
+    Measurement result;
+
+    clock::time_point start = clock::now();
+    size_t allocated = allocations;
+    ChunkyString message = mapInput ? mapFile(inPath) : readFile(inPath);
+    clock::time_point loaded = clock::now();
+    result.load = Stage{chrono::duration<double>(loaded - start).count(),
+                        allocations - allocated};
+
+    allocated = allocations;
+    NoisyTransmission line(how.noise, 1, how.sampling, how.generator);
+    line.transmit(message);
+    clock::time_point transmitted = clock::now();
+    result.transmit = Stage{
+        chrono::duration<double>(transmitted - loaded).count(),
+        allocations - allocated};
+
+    allocated = allocations;
+    int fd = open(outPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        throw system_error(errno, generic_category(), outPath);
+    }
+    writeTo(fd, message);
+    close(fd);
+    clock::time_point written = clock::now();
+    result.write = Stage{chrono::duration<double>(written - transmitted)
+                             .count(),
+                         allocations - allocated};
+    return result;
+}
+
+/**
+ * \brief Run the pipeline in a child process, so that its peak memory
+ *        is measured on its own.
+ *
+ * \returns false if the child failed, after it has said why
+ */
+bool measure(const string& inPath, const string& outPath,
+             const Transmission& how, bool mapInput, Measurement& result,
+             long& peakKb)
+{
+    int channel[2];
+    if (pipe(channel) < 0) {
+        perror("pipe");
+        return false;
+    }
+
+    pid_t child = fork();
+    if (child == 0) {
+        close(channel[0]);
+        try {
+            Measurement measured = runPipeline(inPath, outPath, how,
+                                               mapInput);
+            ssize_t sent = write(channel[1], &measured, sizeof(measured));
+            _exit(sent == ssize_t(sizeof(measured)) ? 0 : 1);
+        } catch (const system_error& err) {
+            cerr << "Unable to run the pipeline: " << err.what() << endl;
+            _exit(1);
+        }
+    }
+
+    close(channel[1]);
+    ssize_t got = child < 0 ? -1 : read(channel[0], &result, sizeof(result));
+    close(channel[0]);
+
+    int status = 0;
+    rusage usage;
+    if (child < 0 || wait4(child, &status, 0, &usage) < 0) {
+        perror("fork");
+        return false;
+    }
+    peakKb = usage.ru_maxrss;
+    return got == ssize_t(sizeof(result)) && WIFEXITED(status)
+           && WEXITSTATUS(status) == 0;
+}
+
+/// Print a Stage of a run over size characters as a JSON object
+void printStage(ostream& out, const char* name, const Stage& stage,
+                size_t size)
+{
+    out << "\"" << name << "\": { \"seconds\": " << stage.seconds
+        << ", \"mb_per_s\": "
+        << (stage.seconds > 0 ? double(size) / 1e6 / stage.seconds : 0)
+        << ", \"allocations\": " << stage.allocations << " }";
+}
+
+int main(int argc, const char* argv[])
+{
+    vector<string> sizes = {"1K", "1M", "64M"};
+    vector<float> noises = {0.001f, 0.01f, 0.1f};
+    bool mapInput = false;
+    string sampling = "skip";
+    string generator = "xoshiro";
+    size_t repeats = 3;
+    string dir = "/tmp";
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string flag = argv[i];
+        string value = argv[i + 1];
+        if (flag == "-s") {
+            sizes = split(value);
+        } else if (flag == "-n") {
+            noises = parseNoises(value);
+        } else if (flag == "-l" && (value == "read" || value == "mmap")) {
+            mapInput = value == "mmap";
+        } else if (flag == "-m" && (value == "each" || value == "skip")) {
+            sampling = value;
+        } else if (flag == "-g"
+                   && (value == "mt19937" || value == "xoshiro"
+                       || value == "pcg")) {
+            generator = value;
+        } else if (flag == "-r") {
+            repeats = stoul(value);
+        } else if (flag == "-d") {
+            dir = value;
+        } else {
+            cerr << "Usage: ./pipeline-bench [-s 1K,1M,64M,1G] "
+                    "[-n 0.001,0.01,0.1] [-l read|mmap] [-m each|skip] "
+                    "[-g mt19937|xoshiro|pcg] [-r repeats] "
+                    "[-d corpusdir]" << endl;
+            return 2;
+        }
+    }
+    if (argc % 2 == 0) {
+        cerr << "Empty argument" << endl;
+        return 2;
+    }
+
+    Transmission how;
+    how.sampling = sampling == "each"
+        ? NoisyTransmission::Sampling::EACH_CHARACTER
+        : NoisyTransmission::Sampling::GEOMETRIC_SKIP;
+    how.generator = generator == "mt19937"
+        ? NoisyTransmission::Generator::MT19937
+        : generator == "xoshiro"
+            ? NoisyTransmission::Generator::XOSHIRO256PP
+            : NoisyTransmission::Generator::PCG32;
+
+    string outPath = dir + "/pipeline-bench-" + to_string(getpid())
+                     + ".out";
+    bool ok = true;
+    cout << "{ \"runs\": [";
+    const char* separator = "\n";
+    for (const string& sizeName : sizes) {
+        size_t size = parseSize(sizeName);
+        string inPath = dir + "/corpus-" + sizeName + ".txt";
+        try {
+            makeCorpus(inPath, size);
+        } catch (const system_error& err) {
+            cerr << "Unable to make corpus: " << err.what() << endl;
+            ok = false;
+            continue;
+        }
+
+        for (float noise : noises) {
+            how.noise = noise;
+            for (size_t repeat = 0; repeat < repeats; ++repeat) {
+                Measurement result;
+                long peakKb;
+                if (!measure(inPath, outPath, how, mapInput, result,
+                             peakKb)) {
+                    ok = false;
+                    continue;
+                }
+
+                cout << separator << "  { \"size\": " << size
+                     << ", \"noise\": " << noise << ", \"load\": \""
+                     << (mapInput ? "mmap" : "read")
+                     << "\", \"sampling\": \"" << sampling
+                     << "\", \"generator\": \"" << generator
+                     << "\", \"repeat\": "
+                     << repeat << ", \"peak_rss_kb\": " << peakKb
+                     << ", \"seconds\": "
+                     << result.load.seconds + result.transmit.seconds
+                        + result.write.seconds
+                     << ",\n    \"stages\": { ";
+                printStage(cout, "load", result.load, size);
+                cout << ",\n                ";
+                printStage(cout, "transmit", result.transmit, size);
+                cout << ",\n                ";
+                printStage(cout, "write", result.write, size);
+                cout << " } }";
+                separator = ",\n";
+            }
+        }
+    }
+    cout << "\n] }" << endl;
+    unlink(outPath.c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+/**
+ * \file random-generators.hpp
+ *
+ * \brief Small, fast random number generators for NoisyTransmission,
+ *        and helpers for turning their output into probabilities.
+ *
+ * \details Each generator meets the standard UniformRandomBitGenerator
+ *   requirements, so it also works with the <random> distributions.
+ *   They are defined here in full so the compiler can inline them into
+ *   the per-character loops.
+ */
+
+#ifndef RANDOM_GENERATORS_HPP_INCLUDED
+#define RANDOM_GENERATORS_HPP_INCLUDED 1
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+/**
+ * \class SplitMix64
+ * \brief Sebastiano Vigna's splitmix64, used to spread a seed over the
+ *        state of the bigger generators.
+ */
+class SplitMix64 {
+public:
+    using result_type = std::uint64_t;
+
+    explicit SplitMix64(std::uint64_t seed) : state_{seed} { }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        std::uint64_t z = (state_ += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+private:
+    std::uint64_t state_;
+};
+
+/**
+ * \class Xoshiro256pp
+ * \brief Blackman and Vigna's xoshiro256++: 256 bits of state, 64 bits
+ *        per call, a handful of shifts and adds.
+ */
+class Xoshiro256pp {
+public:
+    using result_type = std::uint64_t;
+
+    /// Seed the whole state from one number, through SplitMix64
+    explicit Xoshiro256pp(std::uint64_t seed)
+    {
+        SplitMix64 mix(seed);
+        for (std::uint64_t& word : state_) {
+            word = mix();
+        }
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        std::uint64_t result = rotl(state_[0] + state_[3], 23) + state_[0];
+        std::uint64_t t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = rotl(state_[3], 45);
+        return result;
+    }
+
+private:
+    static std::uint64_t rotl(std::uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    std::uint64_t state_[4];
+};
+
+/**
+ * \class Pcg32
+ * \brief O'Neill's PCG-XSH-RR: a 64-bit LCG with a permuted 32-bit
+ *        output.  Different streams are independent sequences, which
+ *        makes them a natural fit for shards.
+ */
+class Pcg32 {
+public:
+    using result_type = std::uint32_t;
+
+    Pcg32(std::uint64_t seed, std::uint64_t stream)
+        : state_{0}, increment_{(stream << 1) | 1}
+    {
+        (*this)();
+        state_ += seed;
+        (*this)();
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        std::uint64_t old = state_;
+        state_ = old * 6364136223846793005ull + increment_;
+        std::uint32_t xorshifted = std::uint32_t(((old >> 18) ^ old) >> 27);
+        std::uint32_t rot = std::uint32_t(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+
+private:
+    std::uint64_t state_;
+    std::uint64_t increment_;
+};
+
+/// Number of random bits in each draw from a generator whose max() is max
+constexpr int randomBits(unsigned long long max)
+{
+    return max == 0 ? 0 : 1 + randomBits(max >> 1);
+}
+
+/**
+ * \brief A uniform float in [0, 1), from the top 24 bits of one draw.
+ *
+ * \details Unlike std::uniform_real_distribution<float> this never
+ *   rounds up to 1, and it costs one multiply.
+ */
+template <typename Gen>
+float randomFloat(Gen& gen)
+{
+    static_assert(Gen::min() == 0 && randomBits(Gen::max()) >= 32,
+                  "needs at least 32 random bits per call");
+    return float(gen() >> (randomBits(Gen::max()) - 24))
+           * (1.0f / 16777216.0f);
+}
+
+/// Fill probs with count uniform floats in [0, 1), as randomFloat would.
+template <typename Gen>
+void fillRandom(Gen& gen, float* probs, size_t count)
+{
+    // a plain loop over an inlined generator, no distribution in between
+    for (size_t i = 0; i < count; ++i) {
+        probs[i] = randomFloat(gen);
+    }
+}
+
+#endif // RANDOM_GENERATORS_HPP_INCLUDED
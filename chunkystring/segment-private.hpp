@@ -0,0 +1,153 @@
+/*********************************************************************
+ * BasicChunkyString::Segment, SegmentIterator and SegmentRange.
+ *********************************************************************
+ *
+ * Implementation of the contiguous-span view returned by segments().
+ *
+ */
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::template SegmentRange<false>
+    BasicChunkyString<CharT, ChunkSize>::segments()
+{
+    return SegmentRange<false>(head_.next_, &head_);
+}
+
+template <typename CharT, size_t ChunkSize>
+typename BasicChunkyString<CharT, ChunkSize>::template SegmentRange<true>
+    BasicChunkyString<CharT, ChunkSize>::segments() const
+{
+    return SegmentRange<true>(head_.next_, &head_);
+}
+
+// ----- Segment -----
+
+template <typename CharT, size_t ChunkSize>
+template <typename SegCharT>
+BasicChunkyString<CharT, ChunkSize>::Segment<SegCharT>::Segment(
+                                            SegCharT* data, size_t size)
+    : data_{data}, size_{size}
+{
+    // Nothing to do here
+}
+
+template <typename CharT, size_t ChunkSize>
+template <typename SegCharT>
+SegCharT* BasicChunkyString<CharT, ChunkSize>::Segment<SegCharT>::data() const
+{
+    return data_;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <typename SegCharT>
+size_t BasicChunkyString<CharT, ChunkSize>::Segment<SegCharT>::size() const
+{
+    return size_;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <typename SegCharT>
+SegCharT* BasicChunkyString<CharT, ChunkSize>::Segment<SegCharT>::begin() const
+{
+    return data_;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <typename SegCharT>
+SegCharT* BasicChunkyString<CharT, ChunkSize>::Segment<SegCharT>::end() const
+{
+    return data_ + size_;
+}
+
+// ----- SegmentIterator -----
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_seg>
+BasicChunkyString<CharT, ChunkSize>::SegmentIterator<const_seg>::
+    SegmentIterator(link_pointer chunk)
+    : chunk_{chunk}
+{
+    // Nothing to do here
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_seg>
+typename BasicChunkyString<CharT, ChunkSize>::template
+    SegmentIterator<const_seg>&
+    BasicChunkyString<CharT, ChunkSize>::SegmentIterator<const_seg>::
+    operator++()
+{
+    chunk_ = chunk_->next_;
+    return *this;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_seg>
+typename BasicChunkyString<CharT, ChunkSize>::template
+    SegmentIterator<const_seg>
+    BasicChunkyString<CharT, ChunkSize>::SegmentIterator<const_seg>::
+    operator++(int)
+{
+    SegmentIterator old = *this;
+    ++*this;
+    return old;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_seg>
+typename BasicChunkyString<CharT, ChunkSize>::template
+    SegmentIterator<const_seg>::value_type
+    BasicChunkyString<CharT, ChunkSize>::SegmentIterator<const_seg>::
+    operator*() const
+{
+    chunk_pointer chunk = static_cast<chunk_pointer>(chunk_);
+    return value_type(chunk->chars_, chunk->length_);
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_seg>
+bool BasicChunkyString<CharT, ChunkSize>::SegmentIterator<const_seg>::
+    operator==(const SegmentIterator& rhs) const
+{
+    return chunk_ == rhs.chunk_;
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_seg>
+bool BasicChunkyString<CharT, ChunkSize>::SegmentIterator<const_seg>::
+    operator!=(const SegmentIterator& rhs) const
+{
+    // Idiomatic code: leverage == to implement !=
+    return !(*this == rhs);
+}
+
+// ----- SegmentRange -----
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_seg>
+BasicChunkyString<CharT, ChunkSize>::SegmentRange<const_seg>::SegmentRange(
+                                    link_pointer first, link_pointer head)
+    : first_{first}, head_{head}
+{
+    // Nothing to do here
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_seg>
+typename BasicChunkyString<CharT, ChunkSize>::template
+    SegmentIterator<const_seg>
+    BasicChunkyString<CharT, ChunkSize>::SegmentRange<const_seg>::
+    begin() const
+{
+    return SegmentIterator<const_seg>(first_);
+}
+
+template <typename CharT, size_t ChunkSize>
+template <bool const_seg>
+typename BasicChunkyString<CharT, ChunkSize>::template
+    SegmentIterator<const_seg>
+    BasicChunkyString<CharT, ChunkSize>::SegmentRange<const_seg>::
+    end() const
+{
+    return SegmentIterator<const_seg>(head_);
+}
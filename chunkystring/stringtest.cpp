@@ -30,16 +30,27 @@
 typedef GenericString TestingString;
 #else
 #include "chunkystring.hpp"         // Just include and link as normal.
+#include "chunkystring-io.hpp"
+#include "noisy-transmission.hpp"
+#include "bounded-queue.hpp"
+#include "allocation-count.hpp"
 typedef ChunkyString TestingString;
 #endif
 
 #include <string>
 #include <sstream>
 #include <stdexcept>
+#include <system_error>
 #include <cstddef>
 #include <cstdlib>
+#include <cstdio>
 #include <cassert>
 #include <cmath>
+#include <algorithm>
+#include <utility>
+#include <memory>
+#include <vector>
+#include <thread>
 
 #include "signal.h"
 #include "unistd.h"
@@ -380,6 +391,56 @@ TEST(constructors, copyConstructor)
     EXPECT_TRUE(original != tiny);
 }
 
+/// Moving hands over the Chunks and leaves the source empty
+TEST(constructors, moveConstructor)
+{
+    static_assert(std::is_nothrow_move_constructible<TestingString>::value
+                  && std::is_nothrow_move_assignable<TestingString>::value,
+                  "containers should relocate strings without copying");
+
+    TestingString original;
+    for (char alpha = 'A'; alpha < 'z'; ++alpha) {
+        original.push_back(alpha);
+    }
+    TestingString copy(original);
+
+    TestingString moved(std::move(original));
+    checkBothIdentical(copy, moved, "moved");
+    checkWithControl(original, "", "moved-from");
+
+    // the moved-from string is still usable
+    original.push_back('m');
+    checkWithControl(original, "m", "reused");
+    checkBothIdentical(copy, moved, "after reuse");
+
+    // move assignment, including onto itself
+    TestingString assigned;
+    assigned.push_back('x');
+    assigned = std::move(moved);
+    checkBothIdentical(copy, assigned, "move assigned");
+    checkWithControl(moved, "", "move-assigned-from");
+    TestingString& alias = assigned;
+    assigned = std::move(alias);
+    checkBothIdentical(copy, assigned, "self move");
+
+    // vector growth relocates strings rather than copying them
+    std::vector<TestingString> strings;
+    for (size_t i = 0; i < 20; ++i) {
+        strings.push_back(copy);
+        strings.back().push_back('a' + i);
+    }
+    for (size_t i = 0; i < strings.size(); ++i) {
+        string control(copy.begin(), copy.end());
+        control.push_back('a' + i);
+        checkWithControl(strings[i], control, "vector " + stringFrom(i));
+    }
+
+    using std::swap;
+    swap(strings.front(), strings.back());
+    EXPECT_EQ('t', *--strings.front().end());
+    EXPECT_EQ('a', *--strings.back().end());
+}
+
 
 /**
  * \brief Assign one TestingString to another, then verify the assignment
@@ -602,6 +663,39 @@ TEST(modifyChars, push_back)
     }
 }
 
+/// push_back takes no new chunks while the string is within its reserve
+TEST(modifyChars, reserve)
+{
+    TestingString test;
+    string control;
+    EXPECT_EQ(TestingString::SMALL_SIZE, test.capacity());
+
+    const size_t SIZE = CHUNKSIZE * 20 + 1;
+    test.reserve(SIZE);
+    size_t capacity = test.capacity();
+    EXPECT_GE(capacity, SIZE);
+    EXPECT_LT(capacity, SIZE + CHUNKSIZE);
+
+    for (size_t i = 0; i < SIZE; ++i) {
+        char next = randomChar();
+        test.push_back(next);
+        control.push_back(next);
+        EXPECT_EQ(capacity, test.capacity()) << "i = " << i;
+    }
+    checkWithControl(test, control, "reserved");
+
+    // reserving what is already there changes nothing
+    test.reserve(1);
+    EXPECT_EQ(capacity, test.capacity());
+
+    // a copy only has room for its own characters
+    test.reserve(2 * SIZE);
+    EXPECT_GE(test.capacity(), 2 * SIZE);
+    TestingString copy = test;
+    checkWithControl(copy, control, "copy");
+    EXPECT_LT(copy.capacity(), SIZE + CHUNKSIZE);
+}
+
 /// Basic iteration tests
 TEST(modifyChars, iterate)
 {
@@ -901,6 +995,709 @@ TEST_F(LongString, iterate)
     EXPECT_TRUE(tIter == testString_.begin());
 }
 
+/// Positional access with at() and iterator_at()
+TEST_F(LongString, at)
+{
+    for (size_t i = 0; i < SIZE; ++i) {
+        ASSERT_EQ(controlString_[i], testString_.at(i)) << "i = " << i;
+    }
+
+    const TestingString& constTest = testString_;
+    EXPECT_EQ(controlString_[SIZE / 2], constTest.at(SIZE / 2));
+    EXPECT_TRUE(testString_.iterator_at(SIZE) == testString_.end());
+    EXPECT_TRUE(constTest.iterator_at(0) == constTest.begin());
+    EXPECT_THROW(testString_.at(SIZE), std::out_of_range);
+    EXPECT_THROW(testString_.iterator_at(SIZE + 1), std::out_of_range);
+
+    // Writing through at()
+    testString_.at(0) = 'a';
+    controlString_[0] = 'a';
+    checkWithControl(testString_, controlString_, "write through at()");
+}
+
+/// Const positional access doesn't build the index, so const readers
+/// can share a string
+TEST_F(LongString, constAtFromThreads)
+{
+    const TestingString& constTest = testString_;
+    vector<thread> readers;
+    vector<size_t> mismatches(4, 0);
+    for (size_t t = 0; t < 4; ++t) {
+        readers.emplace_back([&, t] {
+            for (size_t i = t; i < SIZE; i += 4) {
+                size_t pos = (i * 7919) % SIZE;
+                if (constTest.at(pos) != controlString_[pos]
+                    || *constTest.iterator_at(pos) != controlString_[pos]) {
+                    ++mismatches[t];
+                }
+            }
+        });
+    }
+    for (thread& reader : readers) {
+        reader.join();
+    }
+    for (size_t t = 0; t < 4; ++t) {
+        EXPECT_EQ(0u, mismatches[t]) << "reader " << t;
+    }
+    EXPECT_TRUE(constTest.iterator_at(SIZE) == constTest.end());
+}
+
+#if INSERT_ERASE
+/// The position index has to survive inserts and erases once it exists
+TEST_F(LongString, atAfterEdits)
+{
+    testString_.at(0);  // Start maintaining the index
+
+    for (size_t i = 0; i < 400; ++i) {
+        size_t pos = maybeRandomInt(testString_.size() - 1, RANDOM_VALUE);
+        TestingString::iterator tIter = testString_.iterator_at(pos);
+
+        if (i % 3 == 0) {
+            testString_.erase(tIter);
+            controlString_.erase(pos, 1);
+        } else {
+            char c = randomChar();
+            testString_.insert(tIter, c);
+            controlString_.insert(controlString_.begin() + pos, c);
+        }
+
+        pos = maybeRandomInt(testString_.size() - 1, RANDOM_VALUE);
+        ASSERT_EQ(controlString_[pos], testString_.at(pos)) << "i = " << i;
+    }
+
+    checkWithControl(testString_, controlString_, "after edits");
+
+    for (size_t i = 0; i < controlString_.size(); ++i) {
+        ASSERT_EQ(controlString_[i], testString_.at(i)) << "i = " << i;
+    }
+}
+#endif
+
+/// Iterator differences, with and without the position index
+TEST_F(LongString, iteratorDifference)
+{
+    for (int pass = 0; pass < 2; ++pass) {
+        TestingString::iterator first = testString_.begin();
+        TestingString::iterator last = testString_.end();
+        EXPECT_EQ(ptrdiff_t(SIZE), last - first) << "pass " << pass;
+        EXPECT_EQ(-ptrdiff_t(SIZE), first - last) << "pass " << pass;
+
+        TestingString::iterator mid = first;
+        std::advance(mid, 3 * CHUNKSIZE + 1);
+        EXPECT_EQ(ptrdiff_t(3 * CHUNKSIZE + 1), mid - first);
+        EXPECT_EQ(ptrdiff_t(SIZE - 3 * CHUNKSIZE - 1), last - mid);
+        EXPECT_EQ(0, mid - mid);
+
+        testString_.at(0);  // Second pass goes through the index
+    }
+}
+
+/// Random-access iterator arithmetic, with and without the position index
+TEST_F(LongString, randomAccess)
+{
+    for (int pass = 0; pass < 2; ++pass) {
+        string origin = "pass " + stringFrom(pass);
+        TestingString::iterator first = testString_.begin();
+
+        for (size_t step : { size_t(1), CHUNKSIZE - 1, CHUNKSIZE,
+                             5 * CHUNKSIZE + 3, SIZE / 2 }) {
+            for (size_t pos = 0; pos < SIZE; pos += step) {
+                TestingString::iterator tIter = first + pos;
+                ASSERT_EQ(controlString_[pos], *tIter) << origin;
+                ASSERT_EQ(controlString_[pos], first[pos]) << origin;
+                ASSERT_TRUE(tIter - pos == first) << origin;
+                ASSERT_TRUE(testString_.end() - (SIZE - pos) == tIter)
+                        << origin;
+                ASSERT_TRUE(first <= tIter && tIter < testString_.end())
+                        << origin;
+            }
+        }
+
+        TestingString::iterator tIter = first;
+        tIter += SIZE;
+        EXPECT_TRUE(tIter == testString_.end()) << origin;
+        tIter -= SIZE;
+        EXPECT_TRUE(tIter == first) << origin;
+        EXPECT_TRUE(testString_.end() > first) << origin;
+        EXPECT_FALSE(first > first) << origin;
+        EXPECT_TRUE(first >= first) << origin;
+        EXPECT_EQ(ptrdiff_t(SIZE),
+                  std::distance(first, testString_.end())) << origin;
+
+        testString_.at(0);  // Second pass goes through the index
+    }
+
+    // Standard algorithms pick up the random access
+    TestingString sorted;
+    for (char c = 'a'; c <= 'z'; ++c) {
+        for (size_t i = 0; i < CHUNKSIZE; ++i)
+            sorted.push_back(c);
+    }
+
+    TestingString::iterator found =
+        std::lower_bound(sorted.begin(), sorted.end(), 'm');
+    EXPECT_EQ('m', *found);
+    EXPECT_EQ(ptrdiff_t(('m' - 'a') * CHUNKSIZE), found - sorted.begin());
+}
+
+/// Walk the string a contiguous segment at a time
+TEST_F(LongString, segments)
+{
+    const TestingString& constTest = testString_;
+    string joined;
+    size_t count = 0;
+    for (TestingString::const_segment seg : constTest.segments()) {
+        EXPECT_GT(seg.size(), 0u);
+        EXPECT_LE(seg.size(), CHUNKSIZE);
+        joined.append(seg.data(), seg.size());
+        ++count;
+    }
+    EXPECT_EQ(controlString_, joined);
+    EXPECT_LE(count, (SIZE + CHUNKSIZE - 1) / CHUNKSIZE * 4);
+
+    // characters can be changed in place through mutable segments
+    for (TestingString::segment seg : testString_.segments()) {
+        std::fill(seg.begin(), seg.end(), 'q');
+    }
+    checkWithControl(testString_, string(SIZE, 'q'), "filled");
+
+    TestingString empty;
+    EXPECT_TRUE(empty.segments().begin() == empty.segments().end());
+}
+
+/// Write a string straight to a file descriptor
+TEST(output, writeTo)
+{
+    // enough Chunks that writev needs several batches
+    TestingString test;
+    string control;
+    for (size_t i = 0; i < 3000 * CHUNKSIZE; ++i) {
+        char c = randomChar();
+        test.push_back(c);
+        control.push_back(c);
+    }
+
+    TestingString empty;
+    for (const TestingString* str : { &test, &empty }) {
+        std::FILE* file = std::tmpfile();
+        ASSERT_TRUE(file != nullptr);
+        writeTo(fileno(file), *str);
+
+        std::rewind(file);
+        string read;
+        int c;
+        while ((c = std::fgetc(file)) != EOF) {
+            read.push_back(char(c));
+        }
+        std::fclose(file);
+        EXPECT_EQ(stringFrom(*str), read);
+    }
+    EXPECT_EQ(control, stringFrom(test));
+}
+
+/// Read a string straight from a file descriptor
+TEST(input, readFrom)
+{
+    string control;
+    for (size_t i = 0; i < 100000 + CHUNKSIZE / 2; ++i) {
+        control.push_back(randomChar());
+    }
+
+    std::FILE* file = std::tmpfile();
+    ASSERT_TRUE(file != nullptr);
+    std::fwrite(control.data(), 1, control.size(), file);
+    std::fflush(file);
+    std::rewind(file);
+
+    // appends to what is already there
+    TestingString test;
+    test.push_back('>');
+    readFrom(fileno(file), test);
+    std::fclose(file);
+    checkWithControl(test, ">" + control, "readFrom");
+    checkUtilization(test, 2, "readFrom");
+
+    EXPECT_THROW(readFile<TestingString>("/nonexistent/file"),
+                 std::system_error);
+}
+
+/// Map a file into a string without copying it
+TEST(input, mapFile)
+{
+    string control;
+    for (size_t i = 0; i < 20000; ++i) {
+        control.push_back(randomChar());
+    }
+
+    char path[] = "/tmp/stringtest-XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(ssize_t(control.size()),
+              write(fd, control.data(), control.size()));
+    close(fd);
+
+    TestingString test = mapFile<TestingString>(path);
+    checkWithControl(test, control, "mapped");
+
+    // writes stay in the string, the file is untouched
+    test.at(100) = '#';
+    EXPECT_EQ(control, stringFrom(readFile<TestingString>(path)));
+    control[100] = '#';
+    checkWithControl(test, control, "written");
+
+    // an empty file maps to an empty string
+    truncate(path, 0);
+    checkWithControl(mapFile<TestingString>(path), "", "empty");
+    unlink(path);
+}
+
+#if INSERT_ERASE
+/// Insert whole ranges of characters at various points
+TEST_F(LongString, insertRange)
+{
+    string data("ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                "abcdefghijklmnopqrstuvwxyz" "123456789");
+    while (data.size() < 3 * CHUNKSIZE + 2) {
+        data += data;   // Enough for every length below, whatever CHUNKSIZE
+    }
+
+    for (size_t length : { size_t(0), size_t(1), CHUNKSIZE - 1, CHUNKSIZE,
+                           3 * CHUNKSIZE + 2, data.size() }) {
+        for (size_t pos : { size_t(0), CHUNKSIZE - 1, CHUNKSIZE,
+                            SIZE / 2, SIZE - 1, SIZE }) {
+            TestingString test = testString_;
+            string control = controlString_;
+            string origin = "length: " + stringFrom(length)
+                          + ", pos: " + stringFrom(pos);
+
+            TestingString::iterator tIter = test.begin();
+            std::advance(tIter, pos);
+            tIter = test.insert(tIter, data.data(), length);
+            string::iterator cIter = control.begin() + pos;
+            cIter = control.insert(cIter, data.begin(), data.begin() + length);
+
+            checkIterWithControl(test, control, tIter, cIter, origin);
+            checkUtilization(test, 4, origin);
+        }
+    }
+
+    // Single-pass input
+    TestingString test;
+    std::istringstream in("single pass input");
+    test.insert(test.end(), std::istreambuf_iterator<char>(in),
+                std::istreambuf_iterator<char>());
+    checkWithControl(test, "single pass input", "input iterators");
+}
+
+/// Insert the whole of another, long ChunkyString, whose iterators have
+/// no index to measure the range with
+TEST_F(LongString, insertChunkyRange)
+{
+    TestingString source;
+    string sourceControl;
+    for (size_t i = 0; i < 1000 * CHUNKSIZE + 3; ++i) {
+        char next = randomChar();
+        source.push_back(next);
+        sourceControl.push_back(next);
+    }
+
+    for (size_t pos : { size_t(0), SIZE / 2, SIZE }) {
+        TestingString test = testString_;
+        string control = controlString_;
+        string origin = "pos: " + stringFrom(pos);
+
+        TestingString::iterator tIter =
+            test.insert(test.begin() + pos, source.begin(), source.end());
+        string::iterator cIter = control.insert(
+            control.begin() + pos, sourceControl.begin(), sourceControl.end());
+
+        checkIterWithControl(test, control, tIter, cIter, origin);
+        checkUtilization(test, 4, origin);
+    }
+    checkWithControl(source, sourceControl, "source");
+}
+
+/// Erase whole ranges of characters
+TEST_F(LongString, eraseRange)
+{
+    for (size_t length : { size_t(0), size_t(1), CHUNKSIZE - 1, CHUNKSIZE,
+                           3 * CHUNKSIZE + 2, SIZE / 2 }) {
+        for (size_t pos : { size_t(0), CHUNKSIZE - 1, CHUNKSIZE,
+                            SIZE / 3, SIZE - length }) {
+            TestingString test = testString_;
+            string control = controlString_;
+            string origin = "length: " + stringFrom(length)
+                          + ", pos: " + stringFrom(pos);
+
+            TestingString::iterator first = test.begin();
+            std::advance(first, pos);
+            TestingString::iterator last = first;
+            std::advance(last, length);
+            TestingString::iterator tIter = test.erase(first, last);
+            string::iterator cIter =
+                control.erase(control.begin() + pos,
+                              control.begin() + pos + length);
+
+            checkIterWithControl(test, control, tIter, cIter, origin);
+            checkUtilization(test, 4, origin);
+        }
+    }
+
+    // Erase everything, then in random pieces
+    TestingString test = testString_;
+    test.erase(test.begin(), test.end());
+    checkWithControl(test, "", "erase everything");
+
+    test = testString_;
+    string control = controlString_;
+    while (test.size() > 0) {
+        size_t pos = maybeRandomInt(test.size() - 1, RANDOM_VALUE);
+        size_t length = maybeRandomInt(test.size() - pos, RANDOM_VALUE);
+        TestingString::iterator first = test.begin() + pos;
+        TestingString::iterator tIter = test.erase(first, first + length);
+        string::iterator cIter =
+            control.erase(control.begin() + pos,
+                          control.begin() + pos + length);
+
+        checkIterWithControl(test, control, tIter, cIter, "random pieces");
+        checkUtilization(test, 4, "random pieces");
+    }
+}
+
+/// Compare equal-content strings whose chunks don't line up
+TEST_F(LongString, compareMisaligned)
+{
+    // one fewer character in the first chunk shifts every chunk boundary
+    TestingString shifted;
+    shifted.push_back('x');
+    shifted += testString_;
+    shifted.erase(shifted.begin());
+    checkBothIdentical(testString_, shifted, "misaligned copy");
+
+    for (size_t pos : { size_t(0), CHUNKSIZE - 2, CHUNKSIZE - 1, CHUNKSIZE,
+                        SIZE / 2, SIZE - 1 }) {
+        string origin = "pos: " + stringFrom(pos);
+        char orig = shifted.at(pos);
+        string control = controlString_;
+        for (char c : { 'A', 'z' }) {
+            shifted.at(pos) = c;
+            control[pos] = c;
+            checkTwoWithControl(testString_, shifted, controlString_, control,
+                                origin);
+        }
+        shifted.at(pos) = orig;
+    }
+
+    // a proper prefix sorts first
+    shifted.erase(shifted.end() - 1);
+    checkTwoWithControl(testString_, shifted, controlString_,
+                        controlString_.substr(0, SIZE - 1), "prefix");
+}
+
+/// Edit a string whose characters are borrowed
+TEST_F(LongString, borrow)
+{
+    std::shared_ptr<char> chars(new char[SIZE], std::default_delete<char[]>());
+    std::copy(controlString_.begin(), controlString_.end(), chars.get());
+
+    TestingString test;
+    test.push_back('<');
+    test.borrow(chars.get(), SIZE, chars);
+    test.push_back('>');
+    string control = "<" + controlString_ + ">";
+    checkWithControl(test, control, "borrowed");
+
+    // a copy owns its characters
+    TestingString copy = test;
+    checkWithControl(copy, control, "copy");
+    checkUtilization(copy, 2, "copy");
+
+    size_t positions[] = { 1, CHUNKSIZE, SIZE / 2, SIZE - 1, SIZE };
+    for (size_t pos : positions) {
+        test.insert(test.begin() + pos, '+');
+        control.insert(control.begin() + pos, '+');
+        checkWithControl(test, control, "insert at " + stringFrom(pos));
+    }
+    for (size_t pos : positions) {
+        test.erase(test.begin() + pos);
+        control.erase(control.begin() + pos);
+        checkWithControl(test, control, "erase at " + stringFrom(pos));
+    }
+    TestingString::iterator first = test.begin() + SIZE / 3;
+    test.erase(first, first + CHUNKSIZE + 1);
+    control.erase(SIZE / 3, CHUNKSIZE + 1);
+    checkWithControl(test, control, "erase range");
+
+    // edits copy characters out, they never shift the borrowed ones
+    EXPECT_EQ(controlString_, string(chars.get(), SIZE));
+    checkWithControl(copy, "<" + controlString_ + ">", "copy after edits");
+}
+
+/// Splice whole strings in, with and without a position index
+TEST_F(LongString, splice)
+{
+    string data("ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                "abcdefghijklmnopqrstuvwxyz" "123456789");
+    while (data.size() < 3 * CHUNKSIZE + 2) {
+        data += data;   // Enough for every length below, whatever CHUNKSIZE
+    }
+
+    for (size_t length : { size_t(0), size_t(1), CHUNKSIZE,
+                           3 * CHUNKSIZE + 2, data.size() }) {
+        for (size_t pos : { size_t(0), CHUNKSIZE - 1, CHUNKSIZE,
+                            SIZE / 2, SIZE }) {
+            for (bool indexed : { false, true }) {
+                TestingString test = testString_;
+                TestingString other;
+                other.insert(other.end(), data.data(), length);
+                string control = controlString_;
+                string origin = "length: " + stringFrom(length)
+                              + ", pos: " + stringFrom(pos)
+                              + (indexed ? ", indexed" : "");
+                if (indexed) {
+                    test.iterator_at(0);
+                    other.iterator_at(0);
+                }
+
+                TestingString::iterator tIter =
+                    test.splice(test.begin() + pos, other);
+                string::iterator cIter = control.insert(
+                    control.begin() + pos, data.begin(),
+                    data.begin() + length);
+
+                checkIterWithControl(test, control, tIter, cIter, origin);
+                checkUtilization(test, 4, origin);
+                checkWithControl(other, "", origin + ", other");
+                for (size_t i = 0; i < control.size(); i += CHUNKSIZE - 1) {
+                    EXPECT_EQ(control[i], test.at(i)) << origin;
+                }
+
+                // other is still a usable string
+                other.push_back('!');
+                checkWithControl(other, "!", origin + ", other reused");
+            }
+        }
+    }
+
+    // the spliced Chunks outlive the string they came from, borrowed
+    // ones included
+    std::shared_ptr<char> chars(new char[SIZE], std::default_delete<char[]>());
+    std::copy(controlString_.begin(), controlString_.end(), chars.get());
+    TestingString test;
+    {
+        TestingString borrowing;
+        borrowing.push_back('<');
+        borrowing.borrow(chars.get(), SIZE, chars);
+        test.splice(test.end(), borrowing);
+    }
+    chars.reset();
+    test.insert(test.begin() + SIZE / 2, '+');
+    checkWithControl(test, "<" + controlString_.substr(0, SIZE / 2 - 1) + "+"
+                           + controlString_.substr(SIZE / 2 - 1),
+                     "borrowed");
+
+    // Chunks spliced out of an index into a string without one keep no
+    // trace of it, through swaps and a fresh index alike
+    TestingString indexed = testString_;
+    indexed.iterator_at(0);
+    TestingString plain;
+    TestingString spare;
+    plain.splice(plain.end(), indexed);
+    plain.swap(spare);
+    plain.swap(spare);
+    checkWithControl(plain, controlString_, "spliced from an index");
+    EXPECT_EQ(5, (plain.begin() + 5) - plain.begin());
+    for (size_t i = 0; i < SIZE; i += CHUNKSIZE - 1) {
+        EXPECT_EQ(controlString_[i], plain.at(i)) << "i = " << i;
+    }
+}
+
+/// Concatenation of rvalues takes their Chunks
+TEST_F(LongString, concatenate)
+{
+    TestingString pieces;
+    string control;
+    for (size_t i = 0; i < 3 * CHUNKSIZE; ++i) {
+        TestingString piece = testString_;
+        piece.erase(piece.begin() + i % SIZE, piece.end());
+        control += controlString_.substr(0, i % SIZE);
+        pieces += std::move(piece);
+        checkWithControl(piece, "", "moved from");
+    }
+    checkWithControl(pieces, control, "+= rvalue");
+    checkUtilization(pieces, 4, "+= rvalue");
+
+    TestingString copy = pieces;
+    copy += std::move(copy);
+    checkWithControl(copy, control + control, "self append");
+
+    TestingString first = testString_;
+    TestingString second = testString_;
+    string doubled = controlString_ + controlString_;
+    checkWithControl(first + second, doubled, "const + const");
+    checkWithControl(TestingString(first) + second, doubled, "&& + const");
+    checkWithControl(first + TestingString(second), doubled, "const + &&");
+    checkWithControl(std::move(first) + std::move(second), doubled,
+                     "&& + &&");
+    checkWithControl(second, "", "moved from");
+}
+
+/// Copies and appends pack the characters into full chunks
+TEST_F(LongString, copyRepacks)
+{
+    // splitting every chunk leaves them all about half full
+    TestingString sparse = testString_;
+    string control = controlString_;
+    for (size_t pos = SIZE; pos > 0; pos -= std::min(pos, CHUNKSIZE)) {
+        sparse.insert(sparse.begin() + pos, '!');
+        control.insert(control.begin() + pos, '!');
+    }
+    checkWithControl(sparse, control, "sparse original");
+
+    size_t fullChunks = (control.size() + CHUNKSIZE - 1) / CHUNKSIZE;
+    double packed = double(control.size()) / (fullChunks * CHUNKSIZE);
+
+    TestingString copy = sparse;
+    checkWithControl(copy, control, "copy");
+    EXPECT_DOUBLE_EQ(packed, copy.utilization()) << "copy";
+
+    TestingString appended;
+    appended += sparse;
+    appended += sparse;
+    checkWithControl(appended, control + control, "append");
+    size_t twiceChunks = (2 * control.size() + CHUNKSIZE - 1) / CHUNKSIZE;
+    EXPECT_DOUBLE_EQ(double(2 * control.size()) / (twiceChunks * CHUNKSIZE),
+                     appended.utilization()) << "append";
+
+    // appending to itself copies each original character exactly once
+    sparse += sparse;
+    checkWithControl(sparse, control + control, "self append");
+}
+
+/// Erase every other character of test and control, starting at the front
+void eraseAlternate(TestingString& test, string& control)
+{
+    TestingString::iterator i = test.begin();
+    for (size_t pos = 0; pos < control.size(); ++pos) {
+        i = test.erase(i);
+        control.erase(pos, 1);
+        if (i != test.end()) {
+            ++i;
+        }
+    }
+}
+
+/// Repack on request, and under each compaction policy
+TEST_F(LongString, compaction)
+{
+    typedef TestingString::CompactionPolicy Policy;
+
+    EXPECT_THROW(testString_.set_compaction_policy(Policy(CHUNKSIZE / 2 + 1)),
+                 std::invalid_argument);
+    EXPECT_THROW(testString_.set_compaction_policy(Policy(0, 1.5)),
+                 std::invalid_argument);
+    EXPECT_EQ(CHUNKSIZE / 4, testString_.compaction_policy().minFill);
+    EXPECT_FALSE(testString_.compaction_policy().openGaps);
+
+    // shrink_to_fit packs a sparse string full, borrowed characters aside
+    std::shared_ptr<char> chars(new char[SIZE], std::default_delete<char[]>());
+    std::copy(controlString_.begin(), controlString_.end(), chars.get());
+    TestingString sparse = testString_;
+    string control = controlString_;
+    for (size_t pos = SIZE; pos > 0; pos -= std::min(pos, CHUNKSIZE)) {
+        sparse.insert(sparse.begin() + pos, '!');
+        control.insert(control.begin() + pos, '!');
+    }
+    sparse.borrow(chars.get(), SIZE, chars);
+    control += controlString_;
+    sparse.shrink_to_fit();
+    checkWithControl(sparse, control, "shrink_to_fit");
+    size_t owned = control.size() - SIZE;
+    size_t fullChunks = (owned + CHUNKSIZE - 1) / CHUNKSIZE + 1;
+    EXPECT_DOUBLE_EQ(double(control.size()) / (fullChunks * CHUNKSIZE),
+                     sparse.utilization());
+    EXPECT_EQ(control.size(), sparse.capacity()) << "no chunks to spare";
+    const char* lastSegment = nullptr;
+    for (auto seg : sparse.segments()) {
+        lastSegment = seg.data();
+    }
+    EXPECT_EQ(chars.get(), lastSegment);
+
+    // half-full chunks at most, however the string is erased
+    TestingString half = testString_;
+    control = controlString_;
+    half.set_compaction_policy(Policy(CHUNKSIZE / 2));
+    eraseAlternate(half, control);
+    checkWithControl(half, control, "minFill CHUNKSIZE/2");
+    for (auto seg : half.segments()) {
+        EXPECT_GE(seg.size(), CHUNKSIZE / 2);
+    }
+
+    // with no minimum, only empty chunks go, unless the string repacks
+    TestingString lazy = testString_;
+    TestingString repacking = testString_;
+    control = controlString_;
+    string repackingControl = controlString_;
+    lazy.set_compaction_policy(Policy(0));
+    repacking.set_compaction_policy(Policy(0, 0.75));
+    EXPECT_EQ(0.75, repacking.compaction_policy().repackBelow);
+    eraseAlternate(lazy, control);
+    eraseAlternate(repacking, repackingControl);
+    checkWithControl(lazy, control, "minFill 0");
+    checkWithControl(repacking, repackingControl, "repackBelow 0.75");
+    if (CHUNKSIZE > 1) {
+        EXPECT_LE(lazy.utilization(), 0.5 + 1.0 / CHUNKSIZE);
+    }
+    EXPECT_GE(repacking.utilization(), 0.5);
+    EXPECT_GT(repacking.utilization(), lazy.utilization());
+
+    // the policy goes with the characters
+    TestingString copy = repacking;
+    EXPECT_EQ(0.75, copy.compaction_policy().repackBelow);
+}
+
+/// Sweep edits along a string with wide chunks, as a transmission does,
+/// so that they go through the gaps opened between neighbouring chunks
+TEST(gapBuffer, sweep)
+{
+    typedef BasicChunkyString<char, 256> WideString;
+    WideString test;
+    string control;
+    test.set_compaction_policy(WideString::CompactionPolicy(64, 0, true));
+    for (size_t i = 0; i < 4096; ++i) {
+        char c = randomChar();
+        test.push_back(c);
+        control.push_back(c);
+    }
+
+    for (int maxStep : { 0, 3, 40 }) {
+        WideString::iterator i = test.begin();
+        for (size_t pos = 0; pos < control.size(); ) {
+            if (maybeRandomInt(1, RANDOM_VALUE) == 0) {
+                char c = *i;
+                i = test.insert(i, c);
+                control.insert(control.begin() + pos, c);
+                i += 2;
+                pos += 2;
+            } else {
+                i = test.erase(i);
+                control.erase(pos, 1);
+            }
+            size_t step = std::min(size_t(maybeRandomInt(maxStep,
+                                                          RANDOM_VALUE)),
+                                   control.size() - std::min(pos,
+                                                        control.size()));
+            i += step;
+            pos += step;
+        }
+        string origin = "step up to " + stringFrom(maxStep);
+        EXPECT_EQ(control.size(), test.size()) << origin;
+        EXPECT_EQ(control, string(test.begin(), test.end())) << origin;
+        EXPECT_GE(test.utilization(), 0.25) << origin;
+    }
+}
+#endif
+
 /// Create a low-utilization string by repeated appending
 TEST(utilization, append)
 {
@@ -1113,6 +1910,426 @@ TEST(utilization, erase)
 #endif
 
 
+#if !LOAD_GENERIC_STRING
+//--------------------------------------------------
+//           SMALL STRINGS
+//--------------------------------------------------
+
+static const size_t SMALL_SIZE = TestingString::SMALL_SIZE;
+
+/// A TestingString holding text, built by push_back
+TestingString fromString(const string& text)
+{
+    TestingString result;
+    for (char c : text) {
+        result.push_back(c);
+    }
+    return result;
+}
+
+/// Strings of up to SMALL_SIZE characters never touch the heap
+TEST(smallStrings, noAllocations)
+{
+    for (size_t size : { size_t(1), size_t(8), SMALL_SIZE / 2 + 1,
+                         SMALL_SIZE }) {
+        string origin = "size " + stringFrom(size);
+        string control;
+        for (size_t i = 0; i < size; ++i) {
+            control.push_back('a' + i % 26);
+        }
+        string edited = control;
+        edited.erase(0, 1);
+        edited.insert(edited.begin() + size / 2, '!');
+        string half = control.substr(0, size / 2);
+
+        size_t allocated = allocations;
+        TestingString test;
+        for (char c : control) {
+            test.push_back(c);
+        }
+        TestingString copy = test;
+        TestingString moved(std::move(copy));
+        TestingString other;
+        other.push_back('?');
+        other.swap(moved);
+        TestingString assigned;
+        assigned = other;
+
+        TestingString changed = test;
+        changed.erase(changed.begin());
+        changed.insert(changed.begin() + size / 2, '!');
+        TestingString halves;
+        halves.insert(halves.end(), control.data(), size / 2);
+        TestingString rest = halves;
+        halves += rest;
+        bool same = test == assigned && !(test < assigned);
+        char middle = test.at(size / 2);
+        size_t used = allocations - allocated;
+
+        EXPECT_EQ(0u, used) << origin;
+        EXPECT_TRUE(same) << origin;
+        EXPECT_EQ(control[size / 2], middle) << origin;
+        checkWithControl(test, control, origin);
+        checkWithControl(other, control, origin + " swapped");
+        checkWithControl(moved, "?", origin + " swapped back");
+        checkWithControl(changed, edited, origin + " edited");
+        checkWithControl(halves, half + half, origin + " appended");
+        EXPECT_EQ(SMALL_SIZE, test.capacity()) << origin;
+    }
+}
+
+/// Growing past SMALL_SIZE moves the characters out into Chunks, and
+/// emptying a string doesn't bring it back
+TEST(smallStrings, promotion)
+{
+    string control;
+    for (size_t i = 0; i < SMALL_SIZE; ++i) {
+        control.push_back('A' + i % 26);
+    }
+
+    TestingString pushed = fromString(control);
+    size_t allocated = allocations;
+    pushed.push_back('+');
+    EXPECT_LT(0u, allocations - allocated) << "Chunks for the characters";
+    checkWithControl(pushed, control + "+", "push_back");
+    checkUtilization(pushed, 1, "push_back");
+
+    // the iterator insert returns points at the new character, wherever
+    // the promotion put it
+    for (size_t pos : { size_t(0), SMALL_SIZE / 2 + 1, SMALL_SIZE - 1,
+                        SMALL_SIZE }) {
+        string origin = "insert at " + stringFrom(pos);
+        TestingString test = fromString(control);
+        TestingString::iterator i = test.insert(test.begin() + pos, '#');
+        EXPECT_EQ('#', *i) << origin;
+        EXPECT_EQ(ptrdiff_t(pos), i - test.begin()) << origin;
+        string expected = control;
+        expected.insert(expected.begin() + pos, '#');
+        checkWithControl(test, expected, origin);
+    }
+
+    TestingString ranged = fromString(control.substr(0, 3));
+    ranged.insert(ranged.begin() + 1, control.begin(), control.end());
+    checkWithControl(ranged, control.substr(0, 1) + control
+                             + control.substr(1, 2), "range insert");
+
+    // small strings spliced either way round
+    TestingString big = fromString(control);
+    big += fromString(control);
+    TestingString small = fromString(control.substr(0, 5));
+    TestingString smallCopy = small;
+    big.splice(big.begin() + 3, small);
+    checkWithControl(small, "", "spliced-from small string");
+    smallCopy.splice(smallCopy.begin() + 2, big);
+    string spliced = control + control;
+    spliced.insert(3, control.substr(0, 5));
+    spliced.insert(0, control.substr(0, 2));
+    spliced += control.substr(2, 3);
+    checkWithControl(smallCopy, spliced, "spliced into small string");
+    checkWithControl(big, "", "spliced-from big string");
+
+    // swapping a small string with one in Chunks, then using both
+    TestingString tiny;
+    tiny.push_back('t');
+    swap(tiny, smallCopy);
+    checkWithControl(smallCopy, "t", "swapped small");
+    checkWithControl(tiny, spliced, "swapped big");
+    smallCopy.insert(smallCopy.begin(), spliced.begin(), spliced.end());
+    checkWithControl(smallCopy, spliced + "t", "after the swap");
+
+    // reserving past SMALL_SIZE sets aside room for what is there too
+    TestingString reserved = fromString(control.substr(0, 10));
+    reserved.reserve(4 * SMALL_SIZE);
+    EXPECT_LE(4 * SMALL_SIZE, reserved.capacity());
+    allocated = allocations;
+    for (size_t i = 10; i < 4 * SMALL_SIZE; ++i) {
+        reserved.push_back('r');
+    }
+    EXPECT_EQ(0u, allocations - allocated) << "reserved";
+    EXPECT_EQ(4 * SMALL_SIZE, reserved.size());
+
+    // a string emptied out of its Chunks keeps using them
+    reserved.erase(reserved.begin(), reserved.end());
+    allocated = allocations;
+    reserved.push_back('x');
+    EXPECT_EQ(0u, allocations - allocated) << "emptied";
+    checkWithControl(reserved, "x", "emptied");
+}
+
+//--------------------------------------------------
+//           NOISY TRANSMISSION
+//--------------------------------------------------
+
+typedef NoisyTransmission::Sampling Sampling;
+typedef NoisyTransmission::Generator Generator;
+
+static const Sampling SAMPLINGS[] = { Sampling::EACH_CHARACTER,
+                                      Sampling::GEOMETRIC_SKIP };
+static const Generator GENERATORS[] = { Generator::MT19937,
+                                        Generator::XOSHIRO256PP,
+                                        Generator::PCG32 };
+
+/// A message of size characters cycling through the alphabet, so no
+/// character is next to another like it
+static ChunkyString alphabetMessage(size_t size)
+{
+    ChunkyString message;
+    for (size_t i = 0; i < size; ++i)
+        message.push_back('a' + i % 26);
+    return message;
+}
+
+/// Characters per shard in the transmission tests, small enough that
+/// a short message spans several shards
+static const size_t TEST_SHARD_SIZE = 1000;
+
+/// Threads must not change what arrives, nor must a shard boundary
+TEST(transmission, shardsAndThreads)
+{
+    // three shards, the last one partial
+    ChunkyString message = alphabetMessage(2 * TEST_SHARD_SIZE + 345);
+
+    for (Sampling sampling : SAMPLINGS) {
+        for (Generator generator : GENERATORS) {
+            string origin = "sampling " + stringFrom(int(sampling))
+                            + ", generator " + stringFrom(int(generator));
+
+            // each shard in a thread of its own, against editing in
+            // place, which goes through the shards in order
+            NoisyTransmission threaded(0.05, 70, sampling, generator);
+            NoisyTransmission inPlace(0.05, 70, sampling, generator);
+            threaded.setShardSize(TEST_SHARD_SIZE);
+            inPlace.setShardSize(TEST_SHARD_SIZE);
+            ChunkyString received = threaded.transmitted(message, 4);
+            ChunkyString edited = message;
+            inPlace.transmit(edited);
+
+            EXPECT_FALSE(received == message) << origin;
+            EXPECT_TRUE(received == edited) << origin;
+        }
+    }
+}
+
+/// A seed fixes what arrives; each generator gives its own noise
+TEST(transmission, seeds)
+{
+    ChunkyString message = alphabetMessage(100000);
+    vector<ChunkyString> noises;
+
+    for (Generator generator : GENERATORS) {
+        string origin = "generator " + stringFrom(int(generator));
+        NoisyTransmission first(0.01, 70, Sampling::GEOMETRIC_SKIP, generator);
+        NoisyTransmission again(0.01, 70, Sampling::GEOMETRIC_SKIP, generator);
+        NoisyTransmission other(0.01, 71, Sampling::GEOMETRIC_SKIP, generator);
+        // the same low 32 bits
+        NoisyTransmission high(0.01, 70 + (uint64_t(1) << 32),
+                               Sampling::GEOMETRIC_SKIP, generator);
+
+        ChunkyString received = first.transmitted(message);
+        EXPECT_TRUE(received == again.transmitted(message)) << origin;
+        EXPECT_FALSE(received == other.transmitted(message)) << origin;
+        EXPECT_FALSE(received == high.transmitted(message)) << origin;
+
+        for (const ChunkyString& noise : noises)
+            EXPECT_FALSE(received == noise) << origin;
+        noises.push_back(received);
+    }
+}
+
+/// getRandomFloat and fillRandom draw the same floats, in [0, 1), from
+/// the configured generator
+TEST(transmission, randomFloats)
+{
+    const size_t COUNT = 1000;
+    vector<vector<float>> draws;
+
+    for (Generator generator : GENERATORS) {
+        string origin = "generator " + stringFrom(int(generator));
+        NoisyTransmission one(0.01, 70, Sampling::EACH_CHARACTER, generator);
+        NoisyTransmission many(0.01, 70, Sampling::EACH_CHARACTER, generator);
+
+        vector<float> floats(COUNT);
+        many.fillRandom(floats.data(), COUNT);
+        for (float f : floats) {
+            EXPECT_EQ(f, one.getRandomFloat()) << origin;
+            EXPECT_GE(f, 0.0f) << origin;
+            EXPECT_LT(f, 1.0f) << origin;
+        }
+
+        for (const vector<float>& other : draws)
+            EXPECT_NE(other, floats) << origin;
+        draws.push_back(floats);
+    }
+}
+
+/// Both samplings must corrupt characters at the configured rate: each
+/// character is dropped with chance errorRate, and doubled likewise
+TEST(transmission, errorRate)
+{
+    const size_t SENT = 100000;
+    const double ERROR_RATE = 0.05;
+    ChunkyString message = alphabetMessage(SENT);
+    string sent = stringFrom(message);
+
+    for (Sampling sampling : SAMPLINGS) {
+        for (Generator generator : GENERATORS) {
+            string origin = "sampling " + stringFrom(int(sampling))
+                            + ", generator " + stringFrom(int(generator));
+
+            NoisyTransmission line(ERROR_RATE, 70, sampling, generator);
+            string received = stringFrom(line.transmitted(message));
+
+            // neighbours always differ, so a repeat is a doubled
+            // character and a mismatch is a dropped one
+            size_t dropped = 0;
+            size_t doubled = 0;
+            size_t j = 0;
+            for (size_t i = 0; i < SENT; ++i) {
+                if (j < received.size() && received[j] == sent[i]) {
+                    ++j;
+                    if (j < received.size() && received[j] == sent[i]) {
+                        ++doubled;
+                        ++j;
+                    }
+                } else {
+                    ++dropped;
+                }
+            }
+            ASSERT_EQ(received.size(), j) << origin;
+
+            // each count is binomial: about 5000, with a standard
+            // deviation of sqrt(5000 * 0.95), about 69; allow five of them
+            double expected = ERROR_RATE * SENT;
+            double tolerance = 5 * sqrt(expected * (1 - ERROR_RATE));
+            EXPECT_NEAR(expected, dropped, tolerance) << origin;
+            EXPECT_NEAR(expected, doubled, tolerance) << origin;
+        }
+    }
+}
+
+/// Shards sent one at a time through a queue, as messagepasser --stream
+/// does, must join up into what transmitting the whole message gives
+TEST(transmission, streamed)
+{
+    ChunkyString message = alphabetMessage(2 * TEST_SHARD_SIZE + 345);
+
+    for (Sampling sampling : SAMPLINGS) {
+        string origin = "sampling " + stringFrom(int(sampling));
+        NoisyTransmission whole(0.05, 70, sampling);
+        NoisyTransmission streaming(0.05, 70, sampling);
+        whole.setShardSize(TEST_SHARD_SIZE);
+        streaming.setShardSize(TEST_SHARD_SIZE);
+
+        BoundedQueue<ChunkyString> sent(1);
+        thread reader([&] {
+            for (size_t start = 0; start < message.size();
+                 start += TEST_SHARD_SIZE) {
+                size_t end = min(start + TEST_SHARD_SIZE, message.size());
+                ChunkyString block;
+                block.insert(block.end(), message.begin() + start,
+                             message.begin() + end);
+                sent.push(move(block));
+            }
+            sent.close();
+        });
+
+        uint64_t base = streaming.startShards();
+        ChunkyString received;
+        ChunkyString block;
+        for (size_t shard = 0; sent.pop(block); ++shard)
+            received += streaming.transmittedShard(block, base, shard);
+        reader.join();
+
+        EXPECT_TRUE(received == whole.transmitted(message)) << origin;
+    }
+}
+
+//--------------------------------------------------
+//           BOUNDED QUEUE
+//--------------------------------------------------
+
+/// Items come out in the order they went in
+TEST(boundedQueue, fifo)
+{
+    BoundedQueue<int> queue(3);
+    for (int i = 0; i < 3; ++i)
+        EXPECT_TRUE(queue.push(i));
+
+    int item = -1;
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(queue.pop(item));
+        EXPECT_EQ(i, item);
+    }
+}
+
+/// After close, pushes fail and pops drain what is left, then fail
+TEST(boundedQueue, closeDrains)
+{
+    BoundedQueue<int> queue(4);
+    queue.push(1);
+    queue.push(2);
+    queue.close();
+
+    EXPECT_FALSE(queue.push(3));
+
+    int item = -1;
+    EXPECT_TRUE(queue.pop(item));
+    EXPECT_EQ(1, item);
+    EXPECT_TRUE(queue.pop(item));
+    EXPECT_EQ(2, item);
+    EXPECT_FALSE(queue.pop(item));
+    EXPECT_EQ(2, item);
+    EXPECT_FALSE(queue.pop(item));
+}
+
+/// close wakes a consumer waiting on an empty queue, and a producer
+/// waiting on a full one
+TEST(boundedQueue, closeWakesWaiters)
+{
+    BoundedQueue<int> empty(1);
+    bool popped = true;
+    thread consumer([&] {
+        int item;
+        popped = empty.pop(item);
+    });
+
+    BoundedQueue<int> full(1);
+    full.push(0);
+    bool pushed = true;
+    thread producer([&] { pushed = full.push(1); });
+
+    empty.close();
+    full.close();
+    consumer.join();
+    producer.join();
+    EXPECT_FALSE(popped);
+    EXPECT_FALSE(pushed);
+}
+
+/// A producer faster than its consumer is held back, and nothing is
+/// lost or reordered on the way
+TEST(boundedQueue, producerConsumer)
+{
+    const int COUNT = 10000;
+    BoundedQueue<int> queue(2);
+    thread producer([&] {
+        for (int i = 0; i < COUNT; ++i)
+            queue.push(i);
+        queue.close();
+    });
+
+    int expected = 0;
+    int item;
+    while (queue.pop(item)) {
+        EXPECT_EQ(expected, item);
+        ++expected;
+    }
+    producer.join();
+    EXPECT_EQ(COUNT, expected);
+}
+#endif
+
+
 // Called if the test runs too long.
 static void timeout_handler(int)
 {